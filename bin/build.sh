@@ -0,0 +1,14 @@
+#!/bin/sh
+# Builds the standalone LLC driver bin/crcsim, the trace converter
+# bin/ctconv, the access path benchmark bin/kernelbench and the LIRSplus
+# check bin/lirscheck against src/LLCsim
+cd "$(dirname "$0")/.."
+CXX="g++ -O3 -march=native -flto=auto -DCRC_KIT -Isrc/LLCsim -Isrc/driver"
+LIBS="-lz -lpthread"
+TRACE="src/driver/trace.cpp src/driver/ctrace.cpp src/driver/pipeline.cpp"
+DRIVER="src/driver/crcsim.cpp src/driver/intervals.cpp src/driver/shards.cpp src/driver/sweep.cpp src/driver/stackdist.cpp src/driver/nextuse.cpp"
+
+$CXX -o bin/crcsim $DRIVER $TRACE src/LLCsim/*.cpp $LIBS &&
+$CXX -o bin/ctconv src/driver/ctconv.cpp $TRACE $LIBS &&
+$CXX -o bin/kernelbench src/driver/kernelbench.cpp src/LLCsim/*.cpp $LIBS &&
+$CXX -o bin/lirscheck src/driver/lirscheck.cpp src/LLCsim/*.cpp $LIBS
@@ -0,0 +1,19 @@
+#ifndef ACCESS_H
+#define ACCESS_H
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// One LLC reference as the trace readers hand it out and the batched access  //
+// path of CRC_CACHE takes it                                                 //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+#include "utils.h"
+
+// One LLC reference, exactly the arguments of CRC_CACHE::LookupAndFillCache
+struct Access {
+	Addr_t pc, paddr;
+	UINT32 tid, type;
+};
+
+#endif
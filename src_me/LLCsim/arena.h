@@ -0,0 +1,80 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// One allocation holding the per-set state of a cache. Every set owns a      //
+// block of the same stride, rounded up to whole cache lines, so the tags,    //
+// line state and replacement state of a set sit on adjacent cache lines and  //
+// a set is found by arithmetic instead of following per-set pointers.        //
+// Large arenas can be backed by transparent huge pages.                      //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+#include <cstdlib>
+#include <cstring>
+#include <cassert>
+#include <sys/mman.h>
+#include "utils.h"
+
+class SET_ARENA
+{
+  private:
+    char   *base;
+    size_t stride;
+    size_t bytes;
+    bool   mapped;
+
+  public:
+
+    static const size_t LINE      = 64;
+    static const size_t HUGE_PAGE = 2 << 20;
+
+    static size_t Align( size_t n, size_t to = LINE ) { return (n + to - 1) & ~(to - 1); }
+
+    SET_ARENA( UINT32 sets, size_t setBytes, bool hugePages = false )
+    {
+        stride = Align( setBytes );
+        bytes  = stride * sets;
+        mapped = hugePages && bytes >= HUGE_PAGE;
+
+        if( mapped )
+        {
+            // Anonymous memory is zeroed, ask for huge pages before touching it
+            bytes = Align( bytes, HUGE_PAGE );
+            void *p = mmap( NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+            assert( p != MAP_FAILED );
+            base = (char *)p;
+#ifdef MADV_HUGEPAGE
+            madvise( base, bytes, MADV_HUGEPAGE );
+#endif
+        }
+        else
+        {
+            void *p = NULL;
+            int  err = posix_memalign( &p, LINE, bytes ? bytes : LINE );
+            assert( err == 0 );
+            (void)err;
+            base = (char *)p;
+            memset( base, 0, bytes );
+        }
+    }
+
+    ~SET_ARENA()
+    {
+        if( mapped )
+        {
+            munmap( base, bytes );
+        }
+        else
+        {
+            free( base );
+        }
+    }
+
+    char   *Set( UINT32 setIndex ) { return base + stride * setIndex; }
+    size_t Stride() { return stride; }
+    size_t Bytes() { return bytes; }
+};
+
+#endif
@@ -1,5 +1,9 @@
 #include "crc_cache.h"
 
+#if defined(__AVX2__) || defined(__SSE4_1__)
+#include <immintrin.h>
+#endif
+
 ////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
 //                                                                            //
@@ -38,12 +42,28 @@ string crc_access_names[] =
 // The constructor for the cache with appropriate cache parameters as args    //
 //                                                                            //
 ////////////////////////////////////////////////////////////////////////////////
-CRC_CACHE::CRC_CACHE( UINT32 _cacheSize, UINT32 _assoc, UINT32 _tpc, UINT32 _linesize, UINT32 _pol ) 
+CRC_CACHE::CRC_CACHE( UINT32 _cacheSize, UINT32 _assoc, UINT32 _tpc, UINT32 _linesize, UINT32 _pol, bool _hugePages,
+                      UINT32 _ghosts, bool _compact ) 
 {
 
     // Start off with empty cache and replacement state
-    cache          = NULL;
+    arena          = NULL;
     cacheReplState = NULL;
+    hugePages      = _hugePages;
+    ghosts         = _ghosts;
+    compact        = _compact;
+
+    // No instruments unless enabled
+    instrumented = false;
+    telemetry    = NULL;
+    shadow       = NULL;
+    pcprof       = NULL;
+
+    // Simulate all sets unless asked to sample
+    sampledSets = NULL;
+    numSampled  = 0;
+    setLookups  = NULL;
+    setMisses   = NULL;
 
     // Initialize parameters to the cache
     numsets  = _cacheSize / (_linesize * _assoc);
@@ -63,6 +83,28 @@ CRC_CACHE::CRC_CACHE( UINT32 _cacheSize, UINT32 _assoc, UINT32 _tpc, UINT32 _lin
     InitStats();
 }
 
+CRC_CACHE::~CRC_CACHE()
+{
+    // The replacement state lives in the arena too
+    delete cacheReplState;
+    delete arena;
+
+    for(UINT32 i=0; i<ACCESS_MAX; i++) 
+    {
+        delete [] lookups[i];
+        delete [] misses[i];
+        delete [] hits[i];
+    }
+
+    delete [] sampledSets;
+    delete [] setLookups;
+    delete [] setMisses;
+
+    delete telemetry;
+    delete shadow;
+    delete pcprof;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 //                                                                            //
 // The function initializes the cache hardware and structures                 //
@@ -75,24 +117,58 @@ void CRC_CACHE::InitCache()
     indexShift = CRC_FloorLog2( numsets );    
     indexMask  = (1 << indexShift) - 1;
 
-    // Create the cache structure (first create the sets)
-    cache = new LINE_STATE* [ numsets ];
+    // Lay out a set block: tags, valid mask, line states, replacement state
+    validWords  = (assoc + 63) >> 6;
+    tags32      = Tags32( numsets * linesize * assoc, assoc, linesize, compact );
+    if( compact ) 
+    {
+        // The line states are the dirty mask and the sharing directories
+        assert( threads <= MAX_THREADS );
+        sharingBytes  = threads <= 8 ? 1 : threads <= 16 ? 2 : threads <= 32 ? 4 : 8;
+        validOffset   = SET_ARENA::Align( assoc * (tags32 ? sizeof(UINT32) : sizeof(Addr_t)), 8 );
+        lineOffset    = validOffset + validWords * sizeof(BITVECTOR);
+        sharingOffset = lineOffset + validWords * sizeof(BITVECTOR);
+        replOffset    = SET_ARENA::Align( sharingOffset + assoc * sharingBytes, 8 );
+    }
+    else 
+    {
+        sharingBytes  = 0;
+        validOffset   = assoc * sizeof(Addr_t);
+        lineOffset    = validOffset + validWords * sizeof(BITVECTOR);
+        sharingOffset = 0;
+        replOffset    = SET_ARENA::Align( lineOffset + assoc * sizeof(LINE_STATE), 8 );
+    }
+
+    // Create the cache structure, one arena for all sets
+    arena = new SET_ARENA( numsets, replOffset + CACHE_REPLACEMENT_STATE::SetBytes( replPolicy, assoc, ghosts ), hugePages );
 
     // ensure that we were able to create cache
-    assert(cache);
+    assert(arena);
 
-    // If we were able to create the sets, now create the ways
-    for(UINT32 setIndex=0; setIndex<numsets; setIndex++) 
+    // Initialize the cache ways, all of them start out invalid (the arena
+    // comes zeroed, so the valid and dirty masks and the sharing
+    // directories of the compact layout are clear)
+    for(UINT32 setIndex=0; setIndex<numsets && compact; setIndex++) 
+    {
+        for(UINT32 way=0; way<assoc; way++) 
+        {
+            if( tags32 ) SetTags32( setIndex )[ way ] = 0xdeaddead;
+            else         SetTags( setIndex )[ way ]   = 0xdeaddead;
+        }
+    }
+
+    for(UINT32 setIndex=0; setIndex<numsets && !compact; setIndex++) 
     {
-        cache[ setIndex ] = new LINE_STATE[ assoc ];
+        Addr_t     *setTags  = SetTags( setIndex );
+        LINE_STATE *setLines = SetLines( setIndex );
 
-        // Initialize the cache ways
         for(UINT32 way=0; way<assoc; way++) 
         {
-            cache[ setIndex ][ way ].tag   = 0xdeaddead;
-            cache[ setIndex ][ way ].valid = false;
-            cache[ setIndex ][ way ].dirty = false;
-            cache[ setIndex ][ way ].sharing_dir   = 0;
+            setTags[ way ]              = 0xdeaddead;
+            setLines[ way ].tag         = 0xdeaddead;
+            setLines[ way ].valid       = false;
+            setLines[ way ].dirty       = false;
+            setLines[ way ].sharing_dir = 0;
         }
     }
 
@@ -113,7 +189,20 @@ void CRC_CACHE::InitStats()
         lookups[i] = new COUNTER[ threads ];
         misses[i]  = new COUNTER[ threads ];
         hits[i]    = new COUNTER[ threads ];
+    }
 
+    ResetStats();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// The function zeroes the statistics without touching the cache contents     //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+void CRC_CACHE::ResetStats()
+{
+    for(UINT32 i=0; i<ACCESS_MAX; i++) 
+    {
         for(UINT32 t=0; t<threads; t++) 
         {
             lookups[i][t] = 0;
@@ -121,6 +210,110 @@ void CRC_CACHE::InitStats()
             hits[i][t]    = 0;
         }
     }
+
+    if( sampledSets ) 
+    {
+        for(UINT32 setIndex=0; setIndex<numsets; setIndex++) 
+        {
+            setLookups[ setIndex ] = 0;
+            setMisses[ setIndex ]  = 0;
+        }
+    }
+
+    if( telemetry ) 
+    {
+        telemetry->ResetStats();
+    }
+
+    if( shadow ) 
+    {
+        shadow->ResetStats();
+    }
+
+    if( pcprof ) 
+    {
+        pcprof->ResetStats();
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// The function restricts simulation to the sets whose hashed index falls     //
+// below the requested fraction. At least one set is always kept.             //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+void CRC_CACHE::SetSampling( double fraction, UINT32 seed )
+{
+    if( sampledSets == NULL ) 
+    {
+        sampledSets = new bool[ numsets ];
+        setLookups  = new COUNTER[ numsets ];
+        setMisses   = new COUNTER[ numsets ];
+    }
+
+    numSampled = 0;
+    for(UINT32 setIndex=0; setIndex<numsets; setIndex++) 
+    {
+        // murmur3 finalizer, so that sampled sets do not follow strides
+        UINT32 h = setIndex ^ seed;
+        h ^= h >> 16; h *= 0x85ebca6b;
+        h ^= h >> 13; h *= 0xc2b2ae35;
+        h ^= h >> 16;
+
+        sampledSets[ setIndex ] = (h < fraction * 4294967296.0);
+        numSampled += sampledSets[ setIndex ];
+    }
+
+    if( numSampled == 0 ) 
+    {
+        sampledSets[ 0 ] = 1;
+        numSampled       = 1;
+    }
+
+    ResetStats();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// These functions enable the instruments of LookupAndFillCache and feed      //
+// them every access it makes, after the fact                                 //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+void CRC_CACHE::EnableTelemetry( COUNTER interval, UINT32 capacity )
+{
+    delete telemetry;
+    telemetry    = new CRC_TELEMETRY( indexShift, interval, capacity );
+    instrumented = true;
+}
+
+void CRC_CACHE::EnableMissClassification()
+{
+    delete shadow;
+    shadow       = new CRC_SHADOW( numsets * assoc );
+    instrumented = true;
+}
+
+void CRC_CACHE::EnablePCProfile( UINT32 maxPCs )
+{
+    delete pcprof;
+    pcprof       = new CRC_PCPROF( numsets * assoc, maxPCs );
+    instrumented = true;
+}
+
+void CRC_CACHE::Instrument( UINT32 tid, Addr_t PC, Addr_t paddr, UINT32 accessType, UINT32 setIndex, INT32 wayID,
+                            bool hit, bool evicted )
+{
+    INT32 lineIndex = wayID < 0 ? -1 : (INT32)(setIndex * assoc + wayID);
+
+    if( shadow ) 
+    {
+        shadow->Record( paddr >> lineShift, accessType, hit, lineIndex );
+    }
+
+    if( pcprof ) 
+    {
+        pcprof->Record( PC, paddr >> lineShift, accessType, lineIndex, hit, evicted );
+    }
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -130,7 +323,7 @@ void CRC_CACHE::InitStats()
 ////////////////////////////////////////////////////////////////////////////////
 ostream & CRC_CACHE::PrintStats(ostream &out)
 {
-    COUNTER totLookups = 0, totMisses = 0, totHits = 0;
+    COUNTER totLookups = 0, totMisses = 0;
 
     out<<"=========================================================="<<endl;
     out<<"==== Cache Replacement Championship -- LLC Statistics ===="<<endl;
@@ -153,20 +346,19 @@ ostream & CRC_CACHE::PrintStats(ostream &out)
 
         totLookups = 0;
         totMisses = 0;
-        totHits = 0;
 
         for(UINT32 t=0; t<threads; t++) 
         {
             totLookups += lookups[a][t];
             totMisses  += misses[a][t];
-            totHits    += hits[a][t];
         }
 
         if( totLookups ) 
         {
-            out<<"\t"<<crc_access_names[a]<<" Accesses:   "<<totLookups<<endl;
-            out<<"\t"<<crc_access_names[a]<<" Misses:     "<<totMisses<<endl;
-            out<<"\t"<<crc_access_names[a]<<" Hits:       "<<totHits<<endl;
+            out<<"\t"<<crc_access_names[a]<<" Accesses:   "<<Scale(totLookups)<<endl;
+            out<<"\t"<<crc_access_names[a]<<" Misses:     "<<Scale(totMisses)<<endl;
+            // Scaled on their own, the hits could miss the sum by one
+            out<<"\t"<<crc_access_names[a]<<" Hits:       "<<Scale(totLookups) - Scale(totMisses)<<endl;
             out<<"\t"<<crc_access_names[a]<<" Miss Rate:  "<<((double)totMisses/(double)totLookups)*100.0<<endl;
 
             out<<endl;
@@ -180,21 +372,120 @@ ostream & CRC_CACHE::PrintStats(ostream &out)
     {
         totLookups = ThreadDemandLookupStats(t);
         totMisses  = ThreadDemandMissStats(t);
-        totHits    = ThreadDemandHitStats(t);
 
         if( totLookups )
         {
-            out<<"\tThread: "<<t<<" Lookups: "<<totLookups<<" Misses: "<<totMisses
+            out<<"\tThread: "<<t<<" Lookups: "<<Scale(totLookups)<<" Misses: "<<Scale(totMisses)
                 <<" Miss Rate: "<<((double)totMisses/(double)totLookups)*100.0<<endl;
         }
     }
     out<<endl;
 
+    if( sampledSets ) 
+    {
+        PrintSamplingStats( out );
+    }
+
+    if( shadow ) 
+    {
+        PrintMissClassification( out );
+    }
+
     cacheReplState->PrintStats( out );
      
     return out;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// This function reports the memory the per-set state of the cache takes,     //
+// one line per configuration                                                 //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+ostream & CRC_CACHE::PrintMemory(ostream &out)
+{
+    size_t replBytes = CACHE_REPLACEMENT_STATE::SetBytes( replPolicy, assoc, ghosts );
+
+    out<<"Cache state"<<(tags32 ? " (compact, 32-bit tags)" : compact ? " (compact)" : "")<<": "<<numsets<<" sets x "<<arena->Stride()<<"B = "<<arena->Bytes() / 1048576.0<<"MB"
+       <<" (per set: tags and valid bits "<<lineOffset<<"B, line states "<<replOffset - lineOffset<<"B, replacement "<<replBytes
+       <<"B, padding "<<arena->Stride() - replOffset - replBytes<<"B)"<<endl;
+
+    return out;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// The function prints the whole-cache estimates of a set sampled run. The    //
+// sampled sets are a simple random sample of the sets, so the misses are     //
+// estimated from the per-set mean and the miss rate as a ratio estimate,     //
+// both with the finite population correction.                                //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+void CRC_CACHE::PrintSamplingStats( ostream &out )
+{
+    double n = numSampled, N = numsets;
+    double sumL = 0, sumM = 0;
+
+    for(UINT32 setIndex=0; setIndex<numsets; setIndex++) 
+    {
+        if( sampledSets[ setIndex ] ) 
+        {
+            sumL += setLookups[ setIndex ];
+            sumM += setMisses[ setIndex ];
+        }
+    }
+
+    double meanM = sumM / n, ratio = sumL ? sumM / sumL : 0;
+    double varM = 0, varR = 0;
+
+    for(UINT32 setIndex=0; setIndex<numsets; setIndex++) 
+    {
+        if( sampledSets[ setIndex ] ) 
+        {
+            double dm = setMisses[ setIndex ] - meanM;
+            double dr = setMisses[ setIndex ] - ratio * setLookups[ setIndex ];
+            varM += dm * dm;
+            varR += dr * dr;
+        }
+    }
+
+    double fpc   = 1.0 - n / N;
+    double errM  = n > 1 ? 1.96 * N * sqrt( fpc * varM / (n - 1) / n ) : 0;
+    double meanL = sumL / n;
+    double errR  = (n > 1 && meanL > 0) ? 1.96 * sqrt( fpc * varR / (n - 1) / n ) / meanL : 0;
+
+    out<<"Set Sampling Estimates: "<<endl;
+    out<<"\tSampled Sets:    "<<numSampled<<" of "<<numsets<<endl;
+    out<<"\tTotal Misses:    "<<(COUNTER)(meanM * N + 0.5)<<" +- "<<(COUNTER)(errM + 0.5)<<" (95%)"<<endl;
+    out<<"\tTotal Miss Rate: "<<ratio * 100.0<<" +- "<<errR * 100.0<<" (95%)"<<endl;
+    out<<endl;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// The function prints the misses of every access type by kind, as the        //
+// shadow classified them                                                     //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+void CRC_CACHE::PrintMissClassification( ostream &out )
+{
+    out<<"Miss Classification: "<<endl;
+
+    for(UINT32 a=0; a<ACCESS_MAX; a++) 
+    {
+        COUNTER compulsory = shadow->Misses( a, CRC_SHADOW::COMPULSORY );
+        COUNTER capacity   = shadow->Misses( a, CRC_SHADOW::CAPACITY );
+        COUNTER conflict   = shadow->Misses( a, CRC_SHADOW::CONFLICT );
+
+        if( compulsory + capacity + conflict ) 
+        {
+            out<<"\t"<<crc_access_names[a]<<" Compulsory: "<<compulsory<<" Capacity: "<<capacity
+               <<" Conflict: "<<conflict<<endl;
+        }
+    }
+    out<<endl;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 //                                                                            //
 // The function slects a victim for the given set index. We enforce that      //
@@ -202,22 +493,102 @@ ostream & CRC_CACHE::PrintStats(ostream &out)
 // the replacement policy is consulted to find the victim                     //
 //                                                                            //
 ////////////////////////////////////////////////////////////////////////////////
-INT32 CRC_CACHE::GetVictimInSet( UINT32 tid, UINT32 setIndex, Addr_t PC, Addr_t paddr, UINT32 accessType ) 
+template <class POLICY, UINT32 ASSOC>
+INT32 CRC_CACHE::GetVictimInSetT( UINT32 tid, UINT32 setIndex, Addr_t PC, Addr_t paddr, UINT32 accessType ) 
 {
+    // Fixed geometry when compiled for one
+    const UINT32 assoc      = ASSOC ? ASSOC : this->assoc;
+    const UINT32 validWords = ASSOC ? (ASSOC + 63) >> 6 : this->validWords;
+
     // Get pointer to replacement state of current set
-    LINE_STATE *vicSet = cache[ setIndex ];
+    LINE_STATE *vicSet = compact ? NULL : SetLines( setIndex );
 
-    // First find and fill invalid lines
-    for(UINT32 way=0; way<assoc; way++) 
+    // First find and fill invalid lines: the lowest clear bit of the mask
+    const BITVECTOR *setValid = SetValid( setIndex );
+
+    for(UINT32 w=0; w<validWords; w++) 
     {
-        if( vicSet[way].valid == false ) 
+        UINT32 ways  = std::min( assoc - (w << 6), 64u );
+        BITVECTOR empty = ~setValid[ w ] & (ways == 64 ? ~0ull : (1ull << ways) - 1);
+
+        if( empty ) 
         {
-            return way;
+            return (w << 6) + __builtin_ctzll( empty );
         }
     }
 
     // If no invalid lines, then replace based on replacement policy
-    return cacheReplState->GetVictimInSet( tid, setIndex, vicSet, assoc, PC, paddr, accessType );
+    return POLICY::template Victim<ASSOC>( *cacheReplState, tid, setIndex, vicSet, PC, paddr, accessType );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// The function compares up to 64 contiguous tags against one tag and         //
+// returns the bitmask of the matching ways, several ways per instruction     //
+// when the target has AVX2 or SSE4.1.                                        //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+static inline BITVECTOR MatchTags( const Addr_t *tags, UINT32 ways, Addr_t tag )
+{
+    BITVECTOR match = 0;
+    UINT32 way   = 0;
+
+#if defined(__AVX2__)
+    __m256i key = _mm256_set1_epi64x( (long long)tag );
+
+    for( ; way+4<=ways; way+=4 ) 
+    {
+        __m256i eq = _mm256_cmpeq_epi64( _mm256_loadu_si256( (const __m256i *)(tags + way) ), key );
+        match |= (BITVECTOR)_mm256_movemask_pd( _mm256_castsi256_pd( eq ) ) << way;
+    }
+#elif defined(__SSE4_1__)
+    __m128i key = _mm_set1_epi64x( (long long)tag );
+
+    for( ; way+2<=ways; way+=2 ) 
+    {
+        __m128i eq = _mm_cmpeq_epi64( _mm_loadu_si128( (const __m128i *)(tags + way) ), key );
+        match |= (BITVECTOR)_mm_movemask_pd( _mm_castsi128_pd( eq ) ) << way;
+    }
+#endif
+
+    for( ; way<ways; way++ ) 
+    {
+        match |= (BITVECTOR)(tags[ way ] == tag) << way;
+    }
+
+    return match;
+}
+
+// The same for the 32-bit tags of the compact layout
+static inline BITVECTOR MatchTags32( const UINT32 *tags, UINT32 ways, UINT32 tag )
+{
+    BITVECTOR match = 0;
+    UINT32 way   = 0;
+
+#if defined(__AVX2__)
+    __m256i key = _mm256_set1_epi32( (int)tag );
+
+    for( ; way+8<=ways; way+=8 ) 
+    {
+        __m256i eq = _mm256_cmpeq_epi32( _mm256_loadu_si256( (const __m256i *)(tags + way) ), key );
+        match |= (BITVECTOR)_mm256_movemask_ps( _mm256_castsi256_ps( eq ) ) << way;
+    }
+#elif defined(__SSE4_1__)
+    __m128i key = _mm_set1_epi32( (int)tag );
+
+    for( ; way+4<=ways; way+=4 ) 
+    {
+        __m128i eq = _mm_cmpeq_epi32( _mm_loadu_si128( (const __m128i *)(tags + way) ), key );
+        match |= (BITVECTOR)_mm_movemask_ps( _mm_castsi128_ps( eq ) ) << way;
+    }
+#endif
+
+    for( ; way<ways; way++ ) 
+    {
+        match |= (BITVECTOR)(tags[ way ] == tag) << way;
+    }
+
+    return match;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -226,17 +597,30 @@ INT32 CRC_CACHE::GetVictimInSet( UINT32 tid, UINT32 setIndex, Addr_t PC, Addr_t
 // if the tag was a hit. Else returns -1 if it was a miss.                    //
 //                                                                            //
 ////////////////////////////////////////////////////////////////////////////////
-INT32 CRC_CACHE::LookupSet( UINT32 setIndex, Addr_t tag )
+template <UINT32 ASSOC>
+INT32 CRC_CACHE::LookupSetT( UINT32 setIndex, Addr_t tag )
 {
+    // Fixed geometry when compiled for one
+    const UINT32 assoc      = ASSOC ? ASSOC : this->assoc;
+    const UINT32 validWords = ASSOC ? (ASSOC + 63) >> 6 : this->validWords;
+
     // Get pointer to current set
-    LINE_STATE *currSet = cache[ setIndex ];
+    const Addr_t    *currTags  = SetTags( setIndex );
+    const BITVECTOR *currValid = SetValid( setIndex );
+
+    // The address was wider than ADDRESS_BITS, the driver rejects those
+    assert( !tags32 || !(tag >> 32) );
 
-    // Find Tag
-    for(UINT32 way=0; way<assoc; way++) 
+    // Find Tag among the valid ways
+    for(UINT32 w=0; w<validWords; w++) 
     {
-        if( currSet[way].valid && (currSet[way].tag == tag) ) 
+        UINT32 ways = std::min( assoc - (w << 6), 64u );
+        BITVECTOR hit  = (tags32 ? MatchTags32( SetTags32( setIndex ) + (w << 6), ways, (UINT32)tag )
+                                 : MatchTags( currTags + (w << 6), ways, tag )) & currValid[ w ];
+
+        if( hit ) 
         {
-            return way;
+            return (w << 6) + __builtin_ctzll( hit );
         }
     }
 
@@ -244,6 +628,11 @@ INT32 CRC_CACHE::LookupSet( UINT32 setIndex, Addr_t tag )
     return -1;
 }
 
+INT32 CRC_CACHE::LookupSet( UINT32 setIndex, Addr_t tag )
+{
+    return LookupSetT<0>( setIndex, tag );
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 //                                                                            //
 // The function inspects the cache to see if the tag exists in the cache      //
@@ -272,10 +661,22 @@ bool CRC_CACHE::CacheInspect( UINT32 tid, Addr_t PC, Addr_t paddr, UINT32 access
 // to determine how to update the replacement state.                          //
 //                                                                            //
 ////////////////////////////////////////////////////////////////////////////////
-bool CRC_CACHE::LookupAndFillCache( UINT32 tid, Addr_t PC, Addr_t paddr, UINT32 accessType ) 
+template <class POLICY, UINT32 ASSOC, UINT32 LINE>
+bool CRC_CACHE::LookupAndFillCacheT( UINT32 tid, Addr_t PC, Addr_t paddr, UINT32 accessType ) 
 {
+    // Drop accesses to sets that are not sampled before doing any work; the
+    // false returned is not a miss, nothing counts it
+    if( sampledSets ) 
+    {
+        UINT32 setIndex = GetSetIndex( paddr );
 
-    LINE_STATE *currLine = NULL;
+        if( !sampledSets[ setIndex ] ) 
+        {
+            return false;
+        }
+
+        setLookups[ setIndex ]++;
+    }
 
     // for modeling LRU
     ++mytimer;     
@@ -284,13 +685,112 @@ bool CRC_CACHE::LookupAndFillCache( UINT32 tid, Addr_t PC, Addr_t paddr, UINT32
     // manage stats for cache
     lookups[ accessType ][ tid ]++;
 
+    // Process request
+    INT32 wayID;
+    bool  evicted;
+    bool  hit = LookupAndFillT<POLICY, ASSOC, LINE>( tid, PC, paddr, accessType, wayID, evicted );
+
+    // Update Stats
+    if( hit ) 
+    {
+        hits[ accessType ][ tid ]++;
+    }
+    else 
+    {
+        misses[ accessType ][ tid ]++;
+
+        if( sampledSets ) 
+        {
+            setMisses[ GetSetIndex( paddr ) ]++;
+        }
+    }
+
+    // The telemetry is a counter of the set, inline; the other instruments
+    // are called out of line
+    if( instrumented ) 
+    {
+        UINT32 setIndex = GetSetIndexT<LINE>( paddr );
+
+        if( telemetry ) 
+        {
+            telemetry->Record( setIndex, hit, evicted );
+        }
+
+        if( shadow || pcprof ) 
+        {
+            Instrument( tid, PC, paddr, accessType, setIndex, wayID, hit, evicted );
+        }
+    }
+
+    return hit;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// LookupAndFillCache over a batch of accesses. The set block of the access   //
+// PREFETCH_AHEAD places ahead is prefetched, the accesses themselves are     //
+// made strictly in order, so the results are those of single calls.          //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+template <class POLICY, UINT32 ASSOC, UINT32 LINE>
+void CRC_CACHE::LookupAndFillBatchT( const Access *a, size_t n, bool *hits ) 
+{
+    for(size_t i=0; i<n && i<PREFETCH_AHEAD; i++) 
+    {
+        PrefetchSet( GetSetIndexT<LINE>( a[ i ].paddr ) );
+    }
+
+    for(size_t i=0; i<n; i++) 
+    {
+        if( i + PREFETCH_AHEAD < n ) 
+        {
+            PrefetchSet( GetSetIndexT<LINE>( a[ i + PREFETCH_AHEAD ].paddr ) );
+
+            if( telemetry ) 
+            {
+                telemetry->Prefetch( GetSetIndexT<LINE>( a[ i + PREFETCH_AHEAD ].paddr ) );
+            }
+
+            if( shadow ) 
+            {
+                shadow->Prefetch( a[ i + PREFETCH_AHEAD ].paddr >> lineShift );
+            }
+
+            if( pcprof ) 
+            {
+                pcprof->Prefetch( a[ i + PREFETCH_AHEAD ].paddr >> lineShift );
+            }
+        }
+
+        bool hit = LookupAndFillCacheT<POLICY, ASSOC, LINE>( a[ i ].tid, a[ i ].pc, a[ i ].paddr, a[ i ].type );
+
+        if( hits ) 
+        {
+            hits[ i ] = hit;
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// The lookup and fill of LookupAndFillCache restricted to the set of paddr.  //
+// Neither the timers nor the statistics are touched.                         //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+template <class POLICY, UINT32 ASSOC, UINT32 LINE>
+bool CRC_CACHE::LookupAndFillT( UINT32 tid, Addr_t PC, Addr_t paddr, UINT32 accessType, INT32 &wayID, bool &evicted ) 
+{
+
+    LINE_STATE *currLine = NULL;
+
     // Process request
     bool  hit       = true;
-    UINT32 setIndex = GetSetIndex( paddr );  // Get the set index
-    Addr_t tag      = GetTag( paddr );       // Determine Cache Tag
+    UINT32 setIndex = GetSetIndexT<LINE>( paddr );  // Get the set index
+    Addr_t tag      = GetTagT<LINE>( paddr );       // Determine Cache Tag
 
     // Lookup the cache set to determine whether line is already in cache or not
-    INT32 wayID     = LookupSet( setIndex, tag );
+    wayID           = LookupSetT<ASSOC>( setIndex, tag );
+    evicted         = false;
 
    
     if( wayID == -1 ) 
@@ -298,47 +798,164 @@ bool CRC_CACHE::LookupAndFillCache( UINT32 tid, Addr_t PC, Addr_t paddr, UINT32
         hit = false;
 
         // get victim line to replace (wayID = -1, then bypass)
-        wayID     = GetVictimInSet( tid, setIndex, PC, paddr, accessType );
+        wayID     = GetVictimInSetT<POLICY, ASSOC>( tid, setIndex, PC, paddr, accessType );
 
         if( wayID != -1 )
         {
-            currLine  = &cache[ setIndex ][ wayID ];
-
-            // Update the line state accordingly
-            currLine->valid          = true;
-            currLine->tag            = tag;
-            currLine->dirty          = IS_STORE( accessType );
-            currLine->sharing_dir    = (1<<tid);
+            evicted = LineValid( setIndex, wayID );
+
+            if( compact ) 
+            {
+                // Update the line state accordingly
+                BITVECTOR bit   = 1ull << (wayID & 63);
+                bool      store = IS_STORE( accessType );
+                BITVECTOR &dirty = SetDirty( setIndex )[ wayID >> 6 ];
+
+                dirty = store ? (dirty | bit) : (dirty & ~bit);
+                SetLineSharing( setIndex, wayID, 1ull << tid );
+
+                if( tags32 ) SetTags32( setIndex )[ wayID ] = (UINT32)tag;
+                else         SetTags( setIndex )[ wayID ]   = tag;
+            }
+            else 
+            {
+                currLine  = &SetLines( setIndex )[ wayID ];
+
+                // Update the line state accordingly
+                currLine->valid          = true;
+                currLine->tag            = tag;
+                currLine->dirty          = IS_STORE( accessType );
+                currLine->sharing_dir    = (1<<tid);
+
+                SetTags( setIndex )[ wayID ]          = tag;
+            }
+            SetValid( setIndex )[ wayID >> 6 ]   |= 1ull << (wayID & 63);
 
             // Update Replacement State
-            cacheReplState->UpdateReplacementState( setIndex, wayID, currLine, tid, PC, accessType, hit );
+            POLICY::template Update<ASSOC>( *cacheReplState, setIndex, wayID, currLine, tid, PC, accessType, hit );
         }
-        
-        // Update Stats
-        misses[ accessType ][ tid ]++;
     }
     else 
     {
-        // get pointer to cache line we hit
-        currLine         = &cache[ setIndex ][ wayID ];
-
-        // Update the line state accordingly
-        currLine->dirty         |= IS_STORE( accessType );
-        currLine->sharing_dir   |= (1<<tid);
+        if( compact ) 
+        {
+            // Update the line state accordingly
+            bool store = IS_STORE( accessType );
 
-        // Update Replacement State
-        if( accessType != ACCESS_WRITEBACK ) 
+            SetDirty( setIndex )[ wayID >> 6 ] |= (BITVECTOR)store << (wayID & 63);
+            SetLineSharing( setIndex, wayID, LineSharing( setIndex, wayID ) | (1ull << tid) );
+        }
+        else 
         {
-            cacheReplState->UpdateReplacementState( setIndex, wayID, currLine, tid, PC, accessType, hit );
+            // get pointer to cache line we hit
+            currLine         = &SetLines( setIndex )[ wayID ];
+
+            // Update the line state accordingly
+            currLine->dirty         |= IS_STORE( accessType );
+            currLine->sharing_dir   |= (1<<tid);
         }
 
-        // Update Stats
-        hits[ accessType ][ tid ]++;
+        // Update Replacement State (writebacks only for policies asking
+        // for them, e.g. OPT tracks their next use like any other)
+        if( accessType != ACCESS_WRITEBACK || POLICY::WritebackHits( *cacheReplState ) ) 
+        {
+            POLICY::template Update<ASSOC>( *cacheReplState, setIndex, wayID, currLine, tid, PC, accessType, hit );
+        }
     }        
 
     return hit;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// The plain cache dispatches to its replacement policy at run time           //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+bool CRC_CACHE::LookupAndFillCache( UINT32 tid, Addr_t PC, Addr_t paddr, UINT32 accessType ) 
+{
+    return LookupAndFillCacheT<CACHE_REPLACEMENT_STATE::DYNAMIC, 0, 0>( tid, PC, paddr, accessType );
+}
+
+bool CRC_CACHE::LookupAndFill( UINT32 tid, Addr_t PC, Addr_t paddr, UINT32 accessType ) 
+{
+    INT32 wayID;
+    bool  evicted;
+    return LookupAndFillT<CACHE_REPLACEMENT_STATE::DYNAMIC, 0, 0>( tid, PC, paddr, accessType, wayID, evicted );
+}
+
+void CRC_CACHE::LookupAndFillBatch( const Access *a, size_t n, bool *hits ) 
+{
+    LookupAndFillBatchT<CACHE_REPLACEMENT_STATE::DYNAMIC, 0, 0>( a, n, hits );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// The function creates the statically dispatched cache of a registered       //
+// policy, one instance of CRC_CACHE_T per entry of CRC_POLICIES, and one     //
+// per CRC_SPECIALIZED_ASSOC for 64B lines                                    //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+template <class POLICY>
+static CRC_CACHE *NewCacheT( UINT32 _cacheSize, UINT32 _assoc, UINT32 _tpc, UINT32 _linesize, bool _hugePages, bool _specialize,
+                             UINT32 _ghosts, bool _compact )
+{
+    if( _specialize && _linesize == 64 ) 
+    {
+        switch( _assoc ) 
+        {
+#define CRC_SPECIALIZED_CASE(ASSOC) \
+            case ASSOC: return new CRC_CACHE_T<POLICY, ASSOC, 64>( _cacheSize, _assoc, _tpc, _linesize, _hugePages, _ghosts, _compact );
+            CRC_SPECIALIZED_ASSOC(CRC_SPECIALIZED_CASE)
+#undef CRC_SPECIALIZED_CASE
+        }
+    }
+
+    return new CRC_CACHE_T<POLICY>( _cacheSize, _assoc, _tpc, _linesize, _hugePages, _ghosts, _compact );
+}
+
+template <class... POLICIES>
+static CRC_CACHE *NewCache( CRC_POLICY_LIST<POLICIES...>, UINT32 _cacheSize, UINT32 _assoc, UINT32 _tpc, UINT32 _linesize,
+                            UINT32 _pol, bool _hugePages, bool _specialize, UINT32 _ghosts, bool _compact )
+{
+    static const UINT32 ids[] = { POLICIES::ID... };
+    static CRC_CACHE *(*const create[])( UINT32, UINT32, UINT32, UINT32, bool, bool, UINT32, bool ) = { &NewCacheT<POLICIES>... };
+
+    for(UINT32 i=0; i<sizeof...(POLICIES); i++) 
+    {
+        if( ids[ i ] == _pol ) 
+        {
+            return create[ i ]( _cacheSize, _assoc, _tpc, _linesize, _hugePages, _specialize, _ghosts, _compact );
+        }
+    }
+
+    return NULL;
+}
+
+CRC_CACHE *CRC_NewCache( UINT32 _cacheSize, UINT32 _assoc, UINT32 _tpc, UINT32 _linesize, UINT32 _pol,
+                         bool _hugePages, bool _specialize, UINT32 _ghosts, bool _compact )
+{
+    return NewCache( CRC_POLICIES(), _cacheSize, _assoc, _tpc, _linesize, _pol, _hugePages, _specialize, _ghosts, _compact );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// These functions fold statistics counted outside of the cache (by set       //
+// shard workers calling LookupAndFill) back into the cache                   //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+void CRC_CACHE::AddStats( UINT32 tid, UINT32 accessType, COUNTER lookupCnt, COUNTER hitCnt )
+{
+    lookups[ accessType ][ tid ] += lookupCnt;
+    hits[ accessType ][ tid ]    += hitCnt;
+    misses[ accessType ][ tid ]  += lookupCnt - hitCnt;
+}
+
+void CRC_CACHE::AddTime( COUNTER accesses )
+{
+    mytimer += accesses;
+    cacheReplState->IncrementTimer( accesses );
+}
+
 
 ////////////////////////////////////////////////////////////////////////////////
 //                                                                            //
@@ -347,5 +964,5 @@ bool CRC_CACHE::LookupAndFillCache( UINT32 tid, Addr_t PC, Addr_t paddr, UINT32
 ////////////////////////////////////////////////////////////////////////////////
 void CRC_CACHE::InitCacheReplacementState()
 {
-    cacheReplState = new CACHE_REPLACEMENT_STATE( numsets, assoc, replPolicy );
+    cacheReplState = new CACHE_REPLACEMENT_STATE( numsets, assoc, replPolicy, arena, replOffset, ghosts );
 }
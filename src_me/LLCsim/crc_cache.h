@@ -27,6 +27,15 @@
 #include "utils.h"
 #include "replacement_state.h"
 #include "crc_cache_defs.h"
+#include "access.h"
+#include "telemetry.h"
+#include "shadow.h"
+#include "pcprof.h"
+
+// Compile-time log2 of a power of two (0 for 0)
+template <UINT32 N> struct CRC_Log2 { enum { value = 1 + CRC_Log2<N / 2>::value }; };
+template <> struct CRC_Log2<1> { enum { value = 0 }; };
+template <> struct CRC_Log2<0> { enum { value = 0 }; };
 
 class CRC_CACHE
 {
@@ -39,9 +48,29 @@ class CRC_CACHE
     UINT32 linesize;
     UINT32 replPolicy;
     
-    LINE_STATE               **cache;
     CACHE_REPLACEMENT_STATE  *cacheReplState;
 
+    // All per-set state lives in one arena. A set block holds the tags of
+    // the set, its validWords bitmask words (bit w is way w), the LINE_STATE
+    // copies the policies read and, from replOffset on, the replacement state.
+    SET_ARENA *arena;
+    bool      hugePages;
+    UINT32    ghosts;     // LIRSplus history depth per set, 0 for the default
+    UINT32    validWords;
+    size_t    validOffset;
+    size_t    lineOffset;
+    size_t    replOffset;
+
+    // Compact line state: the tags are 32 bits when the tag of an
+    // ADDRESS_BITS-wide address fits them (tags32), the dirty bits are a
+    // bitmask at lineOffset like the valid ones and the sharing directories
+    // at sharingOffset are sharingBytes wide, enough for the threads. There
+    // are no LINE_STATE copies, the policies get NULL.
+    bool      compact;
+    bool      tags32;
+    UINT32    sharingBytes;
+    size_t    sharingOffset;
+
     // statistics
     COUNTER *lookups[ ACCESS_MAX ];
     COUNTER *misses[ ACCESS_MAX ];
@@ -53,27 +82,208 @@ class CRC_CACHE
     UINT32 indexMask;
 
     COUNTER mytimer; 
+
+    // Set sampling: only sets with sampledSets[set] set are simulated, the
+    // per-set counters feed the confidence interval of the estimate
+    bool    *sampledSets;
+    UINT32  numSampled;
+    COUNTER *setLookups;
+    COUNTER *setMisses;
+
+    // Optional instruments of LookupAndFillCache, instrumented is set when
+    // any of them is, so that a cache without them tests a single flag
+    bool          instrumented;
+    CRC_TELEMETRY *telemetry;
+    CRC_SHADOW    *shadow;
+    CRC_PCPROF    *pcprof;
     
   public:
 
-    CRC_CACHE( UINT32 _cacheSize, UINT32 _assoc, UINT32 _tpc, UINT32 _linesize=64, UINT32 _pol=CRC_REPL_LRU );
+    // The physical address width the compact layout sizes its tags for
+    static const UINT32 ADDRESS_BITS = 48;
+
+    // The threads a sharing directory has a bit for
+    static const UINT32 MAX_THREADS = 64;
+
+    // Whether a cache of this geometry keeps 32-bit tags, which only hold
+    // the tags of addresses at most ADDRESS_BITS wide
+    static bool Tags32( UINT32 cacheSize, UINT32 assoc, UINT32 linesize, bool compact )
+    {
+        return compact && ADDRESS_BITS - CRC_FloorLog2( linesize ) - CRC_FloorLog2( cacheSize / (linesize * assoc) ) <= 32;
+    }
+
+    CRC_CACHE( UINT32 _cacheSize, UINT32 _assoc, UINT32 _tpc, UINT32 _linesize=64, UINT32 _pol=CRC_REPL_LRU, bool _hugePages=false,
+               UINT32 _ghosts=0, bool _compact=false );
+    virtual ~CRC_CACHE();
 
     bool   CacheInspect( UINT32 tid, Addr_t PC, Addr_t paddr, UINT32 accessType );
-    bool   LookupAndFillCache( UINT32 tid, Addr_t PC, Addr_t paddr, UINT32 accessType );
+
+    // True on a hit. Under set sampling an access to a set that is not
+    // simulated also returns false without being a miss: callers that
+    // count the results must skip the accesses Simulated() rejects.
+    virtual bool LookupAndFillCache( UINT32 tid, Addr_t PC, Addr_t paddr, UINT32 accessType );
     ostream &   PrintStats(ostream &out);
 
+    // LookupAndFillCache of n accesses in order, one call for all of them.
+    // The sets PREFETCH_AHEAD accesses ahead are prefetched. The result of
+    // access i goes to hits[i] unless hits is NULL, false for an access
+    // that was not simulated as above.
+    virtual void LookupAndFillBatch( const Access *a, size_t n, bool *hits );
+
+    // One line on the memory of the per-set state, by part
+    ostream &   PrintMemory(ostream &out);
+
+    // Clears the statistics but keeps the cache contents, e.g. after warmup
+    void   ResetStats();
+
+    // The replacement policy internals of PrintStats as a JSON object
+    ostream &   PrintPolicyStatsJSON(ostream &out) { return cacheReplState->PrintStatsJSON( out ); }
+
+    // Next use of the access about to be made, required by CRC_REPL_OPT
+    void   SetNextUse( COUNTER n ) { cacheReplState->SetNextUse( n ); }
+
+    // Simulates only a hash-selected fraction of the sets, accesses to the
+    // others are dropped (and return false, see above) before any tag or
+    // replacement work. PrintStats then scales the counts up to the whole
+    // cache and reports a 95% confidence interval.
+    void   SetSampling( double fraction, UINT32 seed=0 );
+
+    // A count of the simulated sets scaled up to the whole cache
+    COUNTER Scale( COUNTER stat ) { return sampledSets ? (COUNTER)((double)stat * numsets / numSampled + 0.5) : stat; }
+
+    // Whether an access to paddr is simulated, always unless sampling
+    bool   Simulated( Addr_t paddr ) { return !sampledSets || sampledSets[ GetSetIndex( paddr ) ]; }
+
+    // Per-set counters and snapshots of the misses per group of sets every
+    // interval accesses, the last capacity of them kept (see telemetry.h)
+    void   EnableTelemetry( COUNTER interval, UINT32 capacity=1024 );
+    CRC_TELEMETRY *Telemetry() { return telemetry; }
+
+    // Classifies every miss as compulsory, capacity or conflict against a
+    // fully associative LRU shadow of the same capacity (see shadow.h), by
+    // access type in PrintStats. Not meant for sampled caches.
+    void   EnableMissClassification();
+
+    // Accesses, misses, dead evictions and reuse intervals of at most maxPCs
+    // PCs, those with the most misses kept (see pcprof.h)
+    void   EnablePCProfile( UINT32 maxPCs=4096 );
+    CRC_PCPROF *PCProfile() { return pcprof; }
+
+    // Set-sharded simulation: LookupAndFill touches nothing but the set of
+    // paddr (no timers, no statistics), so workers owning disjoint groups of
+    // sets may call it concurrently. They count their own statistics and
+    // fold them back with AddStats/AddTime once they are done. A policy that
+    // samples its state does so in AddTime when the time reaches
+    // NextSample(), which must then find the first NextSample() - 1
+    // accesses made and the workers idle, as the serial run would.
+    virtual bool LookupAndFill( UINT32 tid, Addr_t PC, Addr_t paddr, UINT32 accessType );
+    void   AddStats( UINT32 tid, UINT32 accessType, COUNTER lookupCnt, COUNTER hitCnt );
+    void   AddTime( COUNTER accesses );
+    COUNTER NextSample() { return cacheReplState->NextSample(); }
+
+    UINT32 GetSetIndex( Addr_t addr ) { return ((addr >> lineShift) & indexMask); }
+    UINT32 NumSets() { return numsets; }
+    bool   Tags32() { return tags32; }
+
+    // The state of a line, whichever the layout
+    bool      LineValid( UINT32 setIndex, UINT32 way ) { return (SetValid( setIndex )[ way >> 6 ] >> (way & 63)) & 1; }
+    Addr_t    LineTag( UINT32 setIndex, UINT32 way ) { return tags32 ? SetTags32( setIndex )[ way ] : SetTags( setIndex )[ way ]; }
+    bool      LineDirty( UINT32 setIndex, UINT32 way )
+    {
+        return compact ? (SetDirty( setIndex )[ way >> 6 ] >> (way & 63)) & 1 : SetLines( setIndex )[ way ].dirty;
+    }
+    BITVECTOR LineSharing( UINT32 setIndex, UINT32 way )
+    {
+        if( !compact ) return SetLines( setIndex )[ way ].sharing_dir;
+
+        const char *dir = SetSharing( setIndex ) + way * sharingBytes;
+        switch( sharingBytes ) 
+        {
+            case 1:  return *(const unsigned char *)dir;
+            case 2:  return *(const unsigned short *)dir;
+            case 4:  return *(const UINT32 *)dir;
+            default: return *(const BITVECTOR *)dir;
+        }
+    }
+
   private:
 
     Addr_t GetTag( Addr_t addr ) { return ((addr >> lineShift) >> indexShift); }
-    UINT32 GetSetIndex( Addr_t addr ) { return ((addr >> lineShift) & indexMask); }
+
+    Addr_t     *SetTags( UINT32 setIndex )  { return (Addr_t *)arena->Set( setIndex ); }
+    BITVECTOR  *SetValid( UINT32 setIndex ) { return (BITVECTOR *)(arena->Set( setIndex ) + validOffset); }
+    LINE_STATE *SetLines( UINT32 setIndex ) { return (LINE_STATE *)(arena->Set( setIndex ) + lineOffset); }
+
+    // The compact layout
+    UINT32     *SetTags32( UINT32 setIndex ) { return (UINT32 *)arena->Set( setIndex ); }
+    BITVECTOR  *SetDirty( UINT32 setIndex )  { return (BITVECTOR *)(arena->Set( setIndex ) + lineOffset); }
+    char       *SetSharing( UINT32 setIndex ) { return arena->Set( setIndex ) + sharingOffset; }
+    void       SetLineSharing( UINT32 setIndex, UINT32 way, BITVECTOR dir )
+    {
+        char *p = SetSharing( setIndex ) + way * sharingBytes;
+        switch( sharingBytes ) 
+        {
+            case 1:  *(unsigned char *)p  = (unsigned char)dir; break;
+            case 2:  *(unsigned short *)p = (unsigned short)dir; break;
+            case 4:  *(UINT32 *)p         = (UINT32)dir; break;
+            default: *(BITVECTOR *)p      = dir; break;
+        }
+    }
 
     void   InitCache();
     void   InitCacheReplacementState();
 
     void   InitStats();
+    void   PrintSamplingStats( ostream &out );
+    void   PrintMissClassification( ostream &out );
 
     INT32  LookupSet( UINT32 setIndex, Addr_t tag );
-    INT32  GetVictimInSet( UINT32 tid, UINT32 setIndex, Addr_t PC, Addr_t paddr, UINT32 accessType );
+
+    // Feeds an access to the miss classification and the PC profile
+    void   Instrument( UINT32 tid, Addr_t PC, Addr_t paddr, UINT32 accessType, UINT32 setIndex, INT32 wayID,
+                       bool hit, bool evicted );
+
+    // Far enough ahead for a set block to arrive before its lookup, near
+    // enough not to evict it again
+    static const size_t PREFETCH_AHEAD = 8;
+
+    // The tags and valid mask of a set and the start of its replacement state
+    void   PrefetchSet( UINT32 setIndex )
+    {
+        const char *set = arena->Set( setIndex );
+
+        for(size_t off=0; off<lineOffset; off+=SET_ARENA::LINE) __builtin_prefetch( set + off, 1 );
+        __builtin_prefetch( set + replOffset, 1 );
+    }
+
+  protected:
+
+    // The access paths, with the replacement policy calls bound statically
+    // to POLICY (CACHE_REPLACEMENT_STATE::DYNAMIC for the run-time choice).
+    // ASSOC and LINE fix the associativity and line size at compile time so
+    // that the per-way loops unroll and the shifts become constants; 0 takes
+    // them from the run-time geometry. LookupAndFillT also returns the way
+    // hit or filled (-1 for a bypass) and whether a valid line was evicted.
+    template <class POLICY, UINT32 ASSOC, UINT32 LINE>
+    bool   LookupAndFillCacheT( UINT32 tid, Addr_t PC, Addr_t paddr, UINT32 accessType );
+    template <class POLICY, UINT32 ASSOC, UINT32 LINE>
+    bool   LookupAndFillT( UINT32 tid, Addr_t PC, Addr_t paddr, UINT32 accessType, INT32 &wayID, bool &evicted );
+    template <class POLICY, UINT32 ASSOC, UINT32 LINE>
+    void   LookupAndFillBatchT( const Access *a, size_t n, bool *hits );
+    template <class POLICY, UINT32 ASSOC>
+    INT32  GetVictimInSetT( UINT32 tid, UINT32 setIndex, Addr_t PC, Addr_t paddr, UINT32 accessType );
+    template <UINT32 ASSOC>
+    INT32  LookupSetT( UINT32 setIndex, Addr_t tag );
+
+    template <UINT32 LINE> UINT32 GetSetIndexT( Addr_t addr )
+    {
+        return ((addr >> (LINE ? (UINT32)CRC_Log2<LINE>::value : lineShift)) & indexMask);
+    }
+
+    template <UINT32 LINE> Addr_t GetTagT( Addr_t addr )
+    {
+        return ((addr >> (LINE ? (UINT32)CRC_Log2<LINE>::value : lineShift)) >> indexShift);
+    }
 
   public:
 
@@ -99,6 +309,67 @@ class CRC_CACHE
         return stat;
     }
 
+    COUNTER TotalLookupStats()
+    {
+        COUNTER stat = 0;
+        for(UINT32 a=0; a<ACCESS_MAX; a++) for(UINT32 t=0; t<threads; t++) stat += lookups[a][t];
+        return stat;
+    }
+
+    COUNTER TotalMissStats()
+    {
+        COUNTER stat = 0;
+        for(UINT32 a=0; a<ACCESS_MAX; a++) for(UINT32 t=0; t<threads; t++) stat += misses[a][t];
+        return stat;
+    }
+
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// A cache with its replacement policy fixed at compile time: the policy      //
+// calls of the access path are direct and can be inlined. ASSOC and LINE,    //
+// when not 0, also fix the geometry. Instances exist for the policies of     //
+// CRC_POLICIES, generic and with 64B lines for CRC_SPECIALIZED_ASSOC, and    //
+// CRC_NewCache picks one at run time.                                        //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+template <class POLICY, UINT32 ASSOC=0, UINT32 LINE=0>
+class CRC_CACHE_T : public CRC_CACHE
+{
+  public:
+
+    CRC_CACHE_T( UINT32 _cacheSize, UINT32 _assoc, UINT32 _tpc, UINT32 _linesize=64, bool _hugePages=false, UINT32 _ghosts=0,
+                 bool _compact=false )
+        : CRC_CACHE( _cacheSize, _assoc, _tpc, _linesize, POLICY::ID, _hugePages, _ghosts, _compact )
+    {
+        assert( ASSOC == 0 || ASSOC == _assoc );
+        assert( LINE == 0 || LINE == _linesize );
+    }
+
+    bool   LookupAndFillCache( UINT32 tid, Addr_t PC, Addr_t paddr, UINT32 accessType )
+    {
+        return LookupAndFillCacheT<POLICY, ASSOC, LINE>( tid, PC, paddr, accessType );
+    }
+
+    bool   LookupAndFill( UINT32 tid, Addr_t PC, Addr_t paddr, UINT32 accessType )
+    {
+        INT32 wayID;
+        bool  evicted;
+        return LookupAndFillT<POLICY, ASSOC, LINE>( tid, PC, paddr, accessType, wayID, evicted );
+    }
+
+    void   LookupAndFillBatch( const Access *a, size_t n, bool *hits )
+    {
+        LookupAndFillBatchT<POLICY, ASSOC, LINE>( a, n, hits );
+    }
 };
 
+// The statically dispatched cache for a registered policy, NULL if unknown.
+// Geometries listed in CRC_SPECIALIZED_ASSOC with 64B lines get the access
+// path compiled for them unless specialize is false. A compact cache keeps
+// the compact line state.
+CRC_CACHE *CRC_NewCache( UINT32 _cacheSize, UINT32 _assoc, UINT32 _tpc, UINT32 _linesize, UINT32 _pol,
+                         bool _hugePages=false, bool _specialize=true, UINT32 _ghosts=0, bool _compact=false );
+
 #endif
@@ -0,0 +1,188 @@
+#include <algorithm>
+#include <vector>
+#include "pcprof.h"
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// The profile of a cache of numLines lines, maxPCs rounded up to a power of  //
+// two. The last-access table has 2 to 4 slots per line of the cache.         //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+CRC_PCPROF::CRC_PCPROF( UINT32 _numLines, UINT32 maxPCs )
+{
+    UINT32 bits = CRC_CeilLog2( maxPCs > 1 ? maxPCs : 2 );
+
+    mask      = (1u << bits) - 1;
+    shift     = 64 - bits;
+    table     = new ENTRY[ mask + 1 ]();
+    replaced  = 0;
+
+    UINT32 lastBits = CRC_FloorLog2( _numLines ) + 2;
+
+    lastShift = 64 - lastBits;
+    last      = new LAST[ (size_t)1 << lastBits ]();
+    now       = 0;
+
+    numLines  = _numLines;
+    fillPC    = new Addr_t[ numLines ]();
+    reused    = new bool[ numLines ]();
+}
+
+CRC_PCPROF::~CRC_PCPROF()
+{
+    delete [] table;
+    delete [] last;
+    delete [] fillPC;
+    delete [] reused;
+}
+
+void CRC_PCPROF::ResetStats()
+{
+    for(UINT32 i=0; i<=mask; i++) table[ i ] = ENTRY();
+
+    replaced = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// The entry of PC, taken over from the PC with the fewest load misses of     //
+// its probe window if it has none, whose misses and load misses it inherits  //
+// as their errors                                                            //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+CRC_PCPROF::ENTRY * CRC_PCPROF::Find( Addr_t PC )
+{
+    Addr_t h       = Hash( PC ) >> shift;
+    ENTRY  *victim = NULL;
+
+    for(UINT32 i=0; i<PROBE; i++)
+    {
+        ENTRY *e = table + ((h + i) & mask);
+
+        if( !e->used )
+        {
+            e->used = true;
+            e->pc   = PC;
+            return e;
+        }
+
+        if( e->pc == PC ) return e;
+
+        if( !victim || e->loadMisses < victim->loadMisses
+            || (e->loadMisses == victim->loadMisses && e->misses < victim->misses) ) victim = e;
+    }
+
+    COUNTER inherited     = victim->misses;
+    COUNTER inheritedLoad = victim->loadMisses;
+
+    replaced++;
+    *victim            = ENTRY();
+    victim->used       = true;
+    victim->pc         = PC;
+    victim->misses     = inherited;
+    victim->error      = inherited;
+    victim->loadMisses = inheritedLoad;
+    victim->loadError  = inheritedLoad;
+
+    return victim;
+}
+
+// The entry of PC, NULL if it has none; nothing is inserted
+CRC_PCPROF::ENTRY * CRC_PCPROF::Lookup( Addr_t PC )
+{
+    Addr_t h = Hash( PC ) >> shift;
+
+    for(UINT32 i=0; i<PROBE; i++)
+    {
+        ENTRY *e = table + ((h + i) & mask);
+
+        if( !e->used ) return NULL;
+        if( e->pc == PC ) return e;
+    }
+
+    return NULL;
+}
+
+void CRC_PCPROF::Record( Addr_t PC, Addr_t line, UINT32 accessType, INT32 lineIndex, bool hit, bool evicted )
+{
+    ENTRY *e = Find( PC );
+
+    now++;
+    e->accesses++;
+    if( !hit )
+    {
+        e->misses++;
+        if( accessType == ACCESS_LOAD ) e->loadMisses++;
+    }
+
+    // The accesses since the last one to line, if it is still known
+    LAST *l = last + (Hash( line ) >> lastShift);
+
+    if( l->key == line + 1 )
+    {
+        COUNTER d = now - l->time - 1;
+        UINT32  b = d ? 64 - __builtin_clzll( d ) : 0;
+
+        e->intervals[ b < BINS - 1 ? b : BINS - 1 ]++;
+    }
+    l->key  = line + 1;
+    l->time = now;
+
+    if( lineIndex < 0 ) return;
+
+    // A hit revives the line, a fill charges the line it evicts to its filler
+    // if it never hit
+    if( hit )
+    {
+        reused[ lineIndex ] = true;
+        return;
+    }
+
+    if( evicted && !reused[ lineIndex ] )
+    {
+        ENTRY *filler = Lookup( fillPC[ lineIndex ] );
+
+        if( filler ) filler->deadEvictions++;
+    }
+    fillPC[ lineIndex ] = PC;
+    reused[ lineIndex ] = false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// The top PCs by load misses, then by all misses, with their intervals       //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+ostream & CRC_PCPROF::WriteCSV( ostream &out, UINT32 top )
+{
+    std::vector<const ENTRY *> pcs;
+
+    for(UINT32 i=0; i<=mask; i++)
+    {
+        if( table[ i ].used ) pcs.push_back( table + i );
+    }
+
+    size_t n = std::min( (size_t)top, pcs.size() );
+
+    std::partial_sort( pcs.begin(), pcs.begin() + n, pcs.end(), []( const ENTRY *a, const ENTRY *b ) {
+        return a->loadMisses != b->loadMisses ? a->loadMisses > b->loadMisses : a->misses > b->misses;
+    } );
+
+    out<<"pc,accesses,misses,error,load_misses,load_error,dead_evictions,reuse_0,reuse_1";
+    for(UINT32 b=2; b<BINS-1; b++)
+    {
+        out<<",reuse_"<<(1ull << (b - 1))<<"_"<<(1ull << b) - 1;
+    }
+    out<<",reuse_"<<(1ull << (BINS - 2))<<"_up"<<endl;
+
+    for(size_t i=0; i<n; i++)
+    {
+        const ENTRY *e = pcs[ i ];
+
+        out<<"0x"<<hex<<e->pc<<dec<<","<<e->accesses<<","<<e->misses<<","<<e->error<<","<<e->loadMisses<<","<<e->loadError<<","<<e->deadEvictions;
+        for(UINT32 b=0; b<BINS; b++) out<<","<<e->intervals[ b ];
+        out<<endl;
+    }
+
+    return out;
+}
@@ -0,0 +1,96 @@
+#ifndef PCPROF_H
+#define PCPROF_H
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Per-PC profile of the accesses to a cache: accesses, misses, lines filled  //
+// and evicted without a single hit (dead evictions, charged to the PC that   //
+// filled the line) and a histogram of the reuse intervals, the accesses to   //
+// the cache since the line was last touched, in power-of-two bins.           //
+//                                                                            //
+// The PCs live in a fixed open-addressing table. A PC that finds neither     //
+// itself nor a free slot within PROBE slots of its hash takes over the entry //
+// with the fewest load misses among them, Space-Saving style: it inherits    //
+// those load misses as their error, so its load misses are an upper bound    //
+// at most that error above the true count, the memory stays bounded and the  //
+// PCs with the most load misses, those the profile ranks, stay in. Its       //
+// misses, inherited as well, are at most their own error above the true      //
+// count. A dead eviction is dropped if its filler has left the table. The    //
+// last access of a line is kept in a direct-mapped table of a few times the  //
+// lines of the cache; a line pushed out of it counts as never touched.       //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+#include "utils.h"
+#include "crc_cache_defs.h"
+
+class CRC_PCPROF
+{
+  public:
+
+    // Interval bins 0, 1, 2-3, .., the last one for all longer intervals
+    static const UINT32 BINS  = 24;
+    static const UINT32 PROBE = 8;
+
+    // A cache of numLines lines, at most maxPCs PCs tracked
+    CRC_PCPROF( UINT32 numLines, UINT32 maxPCs );
+    ~CRC_PCPROF();
+
+    // The access of PC to line, which hit or filled the line at lineIndex
+    // (set * assoc + way, -1 for a bypass), evicting a valid line or not
+    void Record( Addr_t PC, Addr_t line, UINT32 accessType, INT32 lineIndex, bool hit, bool evicted );
+
+    // The last-access slot of line, before its access
+    void Prefetch( Addr_t line ) { __builtin_prefetch( last + (Hash( line ) >> lastShift) ); }
+
+    void ResetStats();
+
+    // PCs that took over the entry of another one, 0 unless the table was
+    // too small for the PCs of the run
+    COUNTER Replaced() { return replaced; }
+
+    // The top PCs by load misses, one row each
+    ostream & WriteCSV( ostream &out, UINT32 top );
+
+  private:
+
+    struct ENTRY
+    {
+        Addr_t  pc;
+        bool    used;
+        COUNTER accesses;
+        COUNTER misses;
+        COUNTER loadMisses;
+        COUNTER deadEvictions;
+        COUNTER error;
+        COUNTER loadError;
+        COUNTER intervals[ BINS ];
+    };
+
+    ENTRY   *table;
+    UINT32  mask;
+    UINT32  shift;
+    COUNTER replaced;
+
+    // The last access of a line, line + 1 so that zero is an empty slot
+    struct LAST
+    {
+        Addr_t  key;
+        COUNTER time;
+    };
+
+    LAST    *last;
+    UINT32  lastShift;
+    COUNTER now;
+
+    // The PC that filled each line of the cache, and whether it hit since
+    UINT32  numLines;
+    Addr_t  *fillPC;
+    bool    *reused;
+
+    static Addr_t Hash( Addr_t x ) { return x * 0x9E3779B97F4A7C15ull; }
+    ENTRY  *Find( Addr_t PC );
+    ENTRY  *Lookup( Addr_t PC );
+};
+
+#endif
@@ -42,9 +42,77 @@ CACHE_REPLACEMENT_STATE::CACHE_REPLACEMENT_STATE( UINT32 _sets, UINT32 _assoc, U
 
     mytimer    = 0;
 
+    nextUse    = 0;
+    optBypass  = 0;
+
+    // Standalone state gets an arena of its own
+    arena      = new SET_ARENA( numsets, SetBytes( replPolicy, assoc ) );
+    ownArena   = true;
+    replOffset = 0;
+    ghosts     = GhostDepth( 0 );
+
     InitReplacementState();
 }
 
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Same as above, but the per-set state is placed at the given offset of      //
+// the set blocks of an arena shared with the cache                           //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+CACHE_REPLACEMENT_STATE::CACHE_REPLACEMENT_STATE( UINT32 _sets, UINT32 _assoc, UINT32 _pol, SET_ARENA *_arena, size_t _offset,
+                                                  UINT32 _ghosts )
+{
+
+    numsets    = _sets;
+    assoc      = _assoc;
+    replPolicy = _pol;
+
+    mytimer    = 0;
+
+    nextUse    = 0;
+    optBypass  = 0;
+
+    arena      = _arena;
+    ownArena   = false;
+    replOffset = _offset;
+    ghosts     = GhostDepth( _ghosts );
+
+    InitReplacementState();
+}
+
+CACHE_REPLACEMENT_STATE::~CACHE_REPLACEMENT_STATE()
+{
+	if (replPolicy == CRC_REPL_CONTESTANT) {
+		for (UINT32 i = 0; i < numsets; ++ i) {
+			Lirs(i)->~LIRSplus();
+		}
+	}
+	delete [] last_vic;
+	delete [] mlruBypass;
+	delete [] lirsSamples;
+
+    if( ownArena ) 
+    {
+        delete arena;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Bytes of per-set state of a policy, as its struct in the registry says    //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+size_t CACHE_REPLACEMENT_STATE::SetBytes( UINT32 pol, UINT32 assoc, UINT32 ghosts )
+{
+    const CRC_POLICY_OPS *p = CRC_FindPolicy( pol );
+
+    // ensure that the policy is registered
+    assert(p);
+
+    return p->setBytes( assoc, ghosts );
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 //                                                                            //
 // This function initializes the replacement policy hardware by creating      //
@@ -53,37 +121,34 @@ CACHE_REPLACEMENT_STATE::CACHE_REPLACEMENT_STATE( UINT32 _sets, UINT32 _assoc, U
 ////////////////////////////////////////////////////////////////////////////////
 void CACHE_REPLACEMENT_STATE::InitReplacementState()
 {
-    // Create the state for sets, then create the state for the ways
-    repl  = new LINE_REPLACEMENT_STATE* [ numsets ];
-
-    // ensure that we were able to create replacement state
-    assert(repl);
+    // The LIRSplus trajectory starts out at a sample per 64 accesses a set
+    lirsSamples    = new LIRS_SAMPLE[ LIRS_SAMPLES ];
+    numLirsSamples = 0;
+    lirsInterval   = 64 * (COUNTER)numsets;
 
-    // Create the state for the sets
-    for(UINT32 setIndex=0; setIndex<numsets; setIndex++) 
-    {
-        repl[ setIndex ]  = new LINE_REPLACEMENT_STATE[ assoc ];
+    // Bind the policy first, unknown ones fail here
+    InitPolicy();
 
-        for(UINT32 way=0; way<assoc; way++) 
-        {
-            // initialize stack position (for true LRU)
-            repl[ setIndex ][ way ].LRUstackposition = way;
-            repl[ setIndex ][ way ].location = 0;
-			repl[ setIndex ][ way ].heat = 2 | (way == 0);
-			repl[ setIndex ][ way ].cnt_hit = 0;
-			repl[ setIndex ][ way ].pa = 0;
-			repl[ setIndex ][ way ].pq = way - 1;
-        }
-    }
+    // The state of the ways lives in the set blocks of the arena
+    assert(arena);
 
     // Contestants:  ADD INITIALIZATION FOR YOUR HARDWARE HERE
-	cnt_miss = 0;
-	cnt_hot = new UINT32[numsets];
-	lirs = new LIRSplus[numsets];
+	last_vic = new bool[numsets];
 	for (UINT32 i = 0; i < numsets; ++ i) {
-		cnt_hot[i] = assoc;
-		lirs[i].init(assoc);
+		last_vic[i] = false;
 	}
+	mlruBypass = new COUNTER[numsets]();
+
+    InitSets();
+}
+
+// Only the policy in use has state in the set blocks
+void CACHE_REPLACEMENT_STATE::InitSets()
+{
+    for(UINT32 setIndex=0; setIndex<numsets; setIndex++) 
+    {
+        ops->initSet( *this, setIndex );
+    }
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -105,29 +170,7 @@ INT32 CACHE_REPLACEMENT_STATE::GetVictimInSet( UINT32 tid, UINT32 setIndex, cons
                                                Addr_t PC, Addr_t paddr, UINT32 accessType )
 {
     // If no invalid lines, then replace based on replacement policy
-    if( replPolicy == CRC_REPL_LRU ) 
-    {
-        return Get_LRU_Victim( setIndex );
-    }
-    else if( replPolicy == CRC_REPL_RANDOM )
-    {
-        return Get_Random_Victim( setIndex );
-    }
-    else if( replPolicy == CRC_REPL_CONTESTANT )
-    {
-        // Contestants:  ADD YOUR VICTIM SELECTION FUNCTION HERE
-		// fprintf(stderr, "Miss %lld\n", PC);
-		last_vic = 1;
-		return getLIRSplusVictim(setIndex, PC, paddr, accessType);
-    }
-    else if( replPolicy == CRC_REPL_MLRU) {
-		return getMLRUVictim(setIndex, PC, paddr);
-	}
-
-    // We should never get here
-    assert(0);
-
-    return -1; // Returning -1 bypasses the LLC
+    return DYNAMIC::Victim<0>( *this, tid, setIndex, vicSet, PC, paddr, accessType );
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -144,28 +187,82 @@ void CACHE_REPLACEMENT_STATE::UpdateReplacementState(
     UINT32 setIndex, INT32 updateWayID, const LINE_STATE *currLine, 
     UINT32 tid, Addr_t PC, UINT32 accessType, bool cacheHit )
 {
-    // What replacement policy?
-    if( replPolicy == CRC_REPL_LRU ) 
+    DYNAMIC::Update<0>( *this, setIndex, updateWayID, currLine, tid, PC, accessType, cacheHit );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// These functions look up the policy registry and bind the run-time          //
+// dispatch to the selected policy                                            //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+const CRC_POLICY_OPS *CRC_FindPolicy( UINT32 id )
+{
+    const CRC_POLICY_OPS *ops = CRC_POLICIES::Ops();
+
+    for(UINT32 i=0; i<CRC_POLICIES::COUNT; i++) 
+    {
+        if( ops[ i ].id == id ) 
+        {
+            return &ops[ i ];
+        }
+    }
+
+    return NULL;
+}
+
+const CRC_POLICY_OPS *CRC_FindPolicy( const char *name )
+{
+    const CRC_POLICY_OPS *ops = CRC_POLICIES::Ops();
+
+    for(UINT32 i=0; i<CRC_POLICIES::COUNT; i++) 
     {
-        UpdateLRU( setIndex, updateWayID );
+        if( strcmp( ops[ i ].name, name ) == 0 ) 
+        {
+            return &ops[ i ];
+        }
     }
-    else if( replPolicy == CRC_REPL_RANDOM )
+
+    // Not a name, maybe the number of the policy
+    char *end;
+    unsigned long id = strtoul( name, &end, 10 );
+
+    return (*name && *end == 0) ? CRC_FindPolicy( (UINT32)id ) : NULL;
+}
+
+void CACHE_REPLACEMENT_STATE::InitPolicy()
+{
+    ops = CRC_FindPolicy( replPolicy );
+
+    // ensure that the policy is registered
+    assert(ops);
+
+    // Only LIRSplus has a threshold to follow
+    nextLirsSample = (replPolicy == CRC_REPL_CONTESTANT) ? (mytimer / lirsInterval + 1) * lirsInterval : ~0ull;
+}
+
+// The new policy starts out from its initial state. Its state has to fit in
+// the set blocks when they are shared with the cache, an own arena grows.
+void CACHE_REPLACEMENT_STATE::SetReplacementPolicy( UINT32 _pol )
+{
+    if( replPolicy == CRC_REPL_CONTESTANT ) 
     {
-        // Random replacement requires no replacement state update
+        for(UINT32 setIndex=0; setIndex<numsets; setIndex++) Lirs( setIndex )->~LIRSplus();
     }
-    else if( replPolicy == CRC_REPL_CONTESTANT )
+
+    replPolicy = _pol;
+    InitPolicy();
+
+    size_t bytes = SetBytes( replPolicy, assoc, ghosts );
+    if( replOffset + bytes > arena->Stride() ) 
     {
-        // Contestants:  ADD YOUR UPDATE REPLACEMENT STATE FUNCTION HERE
-        // Feel free to use any of the input parameters to make
-        // updates to your replacement policy
-		if (last_vic) {
-			last_vic = 0;
-			updateLIRSplus(setIndex, updateWayID, PC);
-		}
+        assert( ownArena );
+        delete arena;
+        arena = new SET_ARENA( numsets, bytes );
     }
-	else if ( replPolicy == CRC_REPL_MLRU ) {
-		updateMLRU(setIndex, updateWayID, PC);
-	}
+
+    for(UINT32 setIndex=0; setIndex<numsets; setIndex++) last_vic[ setIndex ] = false;
+    InitSets();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -182,10 +279,20 @@ void CACHE_REPLACEMENT_STATE::UpdateReplacementState(
 // while bottom of LRU stack is 'assoc-1'                                     //
 //                                                                            //
 ////////////////////////////////////////////////////////////////////////////////
+template <UINT32 ASSOC>
 INT32 CACHE_REPLACEMENT_STATE::Get_LRU_Victim( UINT32 setIndex )
 {
+    // Fixed associativity when compiled for one
+    const UINT32 assoc = ASSOC ? ASSOC : this->assoc;
+
+    // Packed sets: the way in the nibble of position assoc-1
+    if( assoc <= PACKED_LRU_WAYS ) 
+    {
+        return (INT32)((*LruOrder( setIndex ) >> ((assoc-1) << 2)) & 0xF);
+    }
+
     // Get pointer to replacement state of current set
-    LINE_REPLACEMENT_STATE *replSet = repl[ setIndex ];
+    LRU_LINE_STATE *replSet = Lines<LRU_LINE_STATE>( setIndex );
 
     INT32   lruWay   = 0;
 
@@ -202,44 +309,92 @@ INT32 CACHE_REPLACEMENT_STATE::Get_LRU_Victim( UINT32 setIndex )
     // return lru way
     return lruWay;
 }
-// #include <cstdio>
+namespace {
+
+// Powers of a decay factor: a score last touched k ticks ago is worth
+// location * f^k now
+const UINT32 DECAY_STEPS = 256;
+struct DecayTable {
+	double f, p[DECAY_STEPS];
+	DecayTable(double f): f(f) {
+		p[0] = 1.;
+		for (UINT32 i = 1; i < DECAY_STEPS; ++ i) {
+			p[i] = p[i - 1] * f;
+		}
+	}
+	double operator ()(UINT32 k) const {
+		return k < DECAY_STEPS ? p[k] : pow(f, (double)k);
+	}
+};
+const DecayTable mlruDecay(.9), strideDecay(.8);
+
+}
+
+double CACHE_REPLACEMENT_STATE::decayed(const LRS& l, UINT32 now, bool stride) const {
+	return l.location * (stride ? strideDecay : mlruDecay)(now - l.stamp);
+}
+
 INT32 CACHE_REPLACEMENT_STATE::getStrideVictim( UINT32 setIndex, Addr_t pc, Addr_t pa )
 {
     // Get pointer to replacement state of current set
-    LINE_REPLACEMENT_STATE *replSet = repl[ setIndex ];
+    LINE_REPLACEMENT_STATE *replSet = ReplSet( setIndex );
+	UINT32 now(MlruSet(setIndex)->decay_now);
 	INT32 shway = 0;
+	double shloc(decayed(replSet[0], now, true));
     for(UINT32 way=1; way<assoc; way++) {
-		if (replSet[way].location < replSet[shway].location) {
-			shway = way;
+		double loc(decayed(replSet[way], now, true));
+		if (loc < shloc) {
+			shway = way, shloc = loc;
 		}
 	}
-	// fprintf(stderr, "%llu %llu\n", pc, pa);
 	replSet[shway].location = 0.;
 	return shway;
 }
 
+// All ways hot, way p at stack position p
+void CACHE_REPLACEMENT_STATE::initMLRU( UINT32 setIndex ) {
+	LINE_REPLACEMENT_STATE* a = ReplSet(setIndex);
+	MlruSet(setIndex)->cnt_hot = assoc;
+	MlruSet(setIndex)->decay_now = 0;
+	for (UINT32 way = 0; way < assoc; ++ way) {
+		a[way].pst = way;
+		a[way].stamp = 0;
+		a[way].location = 0;
+		a[way].heat = 2 | (way == 0);
+		a[way].pq = way - 1;
+		a[way].cnt_hit = 0;
+		a[way].pa = a[way].pc = 0;
+		a[way].type = 0;
+	}
+}
+
+template <UINT32 ASSOC>
 INT32 CACHE_REPLACEMENT_STATE::getMLRUVictim( UINT32 setIndex, Addr_t pc, Addr_t pa )
 {
-	++ cnt_miss;
-	last_vic = 1;
-	UINT32 selw;
+	// Fixed associativity when compiled for one
+	const UINT32 assoc = ASSOC ? ASSOC : this->assoc;
+
+	last_vic[setIndex] = true;
 	INT32 res = -1;
-	LINE_REPLACEMENT_STATE* a = repl[setIndex];
-	for (selw = 0; selw < assoc; ++ selw) {
-		if (a[selw].heat == 0 && a[selw].LRUstackposition == 0) {
-			res = selw;
-			a[res].cnt_hit = 0;
-			a[selw].LRUstackposition = assoc - cnt_hot[setIndex] - 1;
-		} else if (a[selw].heat == 0) {
-			-- a[selw].LRUstackposition;
-		}
+	LINE_REPLACEMENT_STATE* a = ReplSet(setIndex);
+	UINT32 cold_pst(assoc - MlruSet(setIndex)->cnt_hot - 1);
+	// The cold way at the bottom is the victim and goes back to the top of
+	// the cold ways, the other cold ones move down
+	for (UINT32 selw = 0; selw < assoc; ++ selw) {
+		UINT32 cold(a[selw].heat == 0), z(cold & (a[selw].pst == 0));
+		res = z ? (INT32)selw : res;
+		a[selw].cnt_hit = z ? 0 : a[selw].cnt_hit;
+		a[selw].pst = z ? cold_pst : a[selw].pst - cold;
+	}
+	// No cold way at the bottom bypasses, which must not touch a[-1]: it
+	// is the line state of the cache in front of the replacement state
+	if (res == -1) {
+		++ mlruBypass[setIndex];
+		return res;
 	}
 	a[res].location = 0.;
 	a[res].pa = pa;
 	a[res].pc = pc;
-	if (res == -1) {
-		fprintf(stderr, "?!!!?\n");
-	}
 	return res;
 }
 
@@ -248,8 +403,12 @@ INT32 CACHE_REPLACEMENT_STATE::getMLRUVictim( UINT32 setIndex, Addr_t pc, Addr_t
 // This function finds a random victim in the cache set                       //
 //                                                                            //
 ////////////////////////////////////////////////////////////////////////////////
+template <UINT32 ASSOC>
 INT32 CACHE_REPLACEMENT_STATE::Get_Random_Victim( UINT32 setIndex )
 {
+    // Fixed associativity when compiled for one
+    const UINT32 assoc = ASSOC ? ASSOC : this->assoc;
+
     INT32 way = (rand() % assoc);
     return way;
 }
@@ -261,37 +420,64 @@ INT32 CACHE_REPLACEMENT_STATE::Get_Random_Victim( UINT32 setIndex )
 // way and set index.                                                         //
 //                                                                            //
 ////////////////////////////////////////////////////////////////////////////////
+template <UINT32 ASSOC>
 void CACHE_REPLACEMENT_STATE::UpdateLRU( UINT32 setIndex, INT32 updateWayID )
 {
+    // Fixed associativity when compiled for one
+    const UINT32 assoc = ASSOC ? ASSOC : this->assoc;
+
+    if( assoc <= PACKED_LRU_WAYS ) 
+    {
+        const BITVECTOR ones  = 0x1111111111111111ull;
+        BITVECTOR       order = *LruOrder( setIndex );
+
+        // Stack position of the way: its nibble is the lowest zero nibble of
+        // order ^ way (higher flags may be borrows, the lowest one is exact)
+        BITVECTOR diff  = order ^ (ones * (BITVECTOR)updateWayID);
+        UINT32    shift = __builtin_ctzll( (diff - ones) & ~diff & (ones << 3) ) - 3;
+
+        // The ways above it move down one position, the way goes on top
+        BITVECTOR above = (1ull << shift) - 1;
+        *LruOrder( setIndex ) = (order & ~(above | (0xFull << shift))) | ((order & above) << 4) | (BITVECTOR)updateWayID;
+        return;
+    }
+
+    LRU_LINE_STATE *replSet = Lines<LRU_LINE_STATE>( setIndex );
+
     // Determine current LRU stack position
-    UINT32 currLRUstackposition = repl[ setIndex ][ updateWayID ].LRUstackposition;
+    UINT32 currLRUstackposition = replSet[ updateWayID ].LRUstackposition;
 
     // Update the stack position of all lines before the current line
     // Update implies incremeting their stack positions by one
     for(UINT32 way=0; way<assoc; way++) 
     {
-        if( repl[setIndex][way].LRUstackposition < currLRUstackposition ) 
+        if( replSet[way].LRUstackposition < currLRUstackposition ) 
         {
-            repl[setIndex][way].LRUstackposition++;
+            replSet[way].LRUstackposition++;
         }
     }
 
     // Set the LRU stack position of new line to be zero
-    repl[ setIndex ][ updateWayID ].LRUstackposition = 0;
+    replSet[ updateWayID ].LRUstackposition = 0;
 }
 
+template <UINT32 ASSOC>
 void CACHE_REPLACEMENT_STATE::updateMLRU( UINT32 setIndex, INT32 updateWayID, Addr_t pc ) {
-	if (last_vic) {
-		last_vic = 0;
+	// Fixed associativity when compiled for one
+	const UINT32 assoc = ASSOC ? ASSOC : this->assoc;
+
+	if (last_vic[setIndex]) {
+		last_vic[setIndex] = false;
 		return;
 	}
-	LINE_REPLACEMENT_STATE* a = repl[setIndex];
+	LINE_REPLACEMENT_STATE* a = ReplSet(setIndex);
+	UINT32& cnt_hot(MlruSet(setIndex)->cnt_hot);
 	UINT32 selw, zero_way;
-	// fprintf(stderr, "%d %d %d %d\n", cnt_miss, setIndex, a[updateWayID].heat, a[updateWayID].LRUstackposition);
 
-	for (UINT32 i = 0; i < assoc; ++ i) {
-		a[i].location *= .9;
-	}
+	// Only the updated way is rescaled, the others keep their stamps
+	UINT32 now(++ MlruSet(setIndex)->decay_now);
+	a[uid].location = decayed(a[uid], now, false);
+	a[uid].stamp = now;
 	if ((a[uid].pa ^ pc) & ~0xffu) {
 		a[uid].pc = 0;
 	}
@@ -302,63 +488,56 @@ void CACHE_REPLACEMENT_STATE::updateMLRU( UINT32 setIndex, INT32 updateWayID, Ad
 	}
 	++ a[updateWayID].cnt_hit;
 	if (a[updateWayID].heat == 1) {
+		UINT32 p(a[uid].pst);
 		for (selw = 0; selw < assoc; ++ selw) {
-			if (a[selw].heat) {
-				if (a[selw].LRUstackposition > a[updateWayID].LRUstackposition) {
-					-- a[selw].LRUstackposition;
-				}
-			}
+			a[selw].pst -= (a[selw].heat != 0) & (a[selw].pst > p);
 		}
-		a[updateWayID].LRUstackposition = cnt_hot[setIndex] - 1;
-	} else if ((cnt_hot[setIndex] << 2) < assoc) {
+		a[updateWayID].LRUstackposition = cnt_hot - 1;
+	} else if ((cnt_hot << 2) < assoc) {
+		UINT32 p(a[uid].pst);
 		for (selw = 0; selw < assoc; ++ selw) {
-			if (!a[selw].heat && a[selw].pst > a[uid].pst) {
-				-- a[selw].pst;
-			}
+			a[selw].pst -= (a[selw].heat == 0) & (a[selw].pst > p);
 		}
 		a[updateWayID].heat = 1;
-		a[updateWayID].LRUstackposition = cnt_hot[setIndex] ++;
+		a[updateWayID].LRUstackposition = cnt_hot ++;
 	} else {
 		UINT32 min_hit = 0x3f3f3f3f;
 		double min_pos = 1e10;
 		for (UINT32 i = 0; i < assoc; ++ i) {
-			if (a[i].heat && a[i].cnt_hit < min_hit) {
-				min_hit = a[i].cnt_hit;
-			}
-			if (a[i].heat && a[i].location < min_pos) {
-				min_pos = a[i].location;
-			}
+			UINT32 hit(a[i].heat ? a[i].cnt_hit : min_hit);
+			double pos(a[i].heat ? decayed(a[i], now, false) : min_pos);
+			min_hit = hit < min_hit ? hit : min_hit;
+			min_pos = pos < min_pos ? pos : min_pos;
 		}
 		if (true || min_pos < a[uid].location) {
+			// The hot way at the bottom turns cold, the other hot ones and
+			// the cold ones above the updated way move down. The updated way
+			// may move itself, so its position is read at every step.
 			zero_way = 0;
 			for (selw = 0; selw < assoc; ++ selw) {
-				if (a[selw].heat && a[selw].LRUstackposition == 0) {
-					zero_way = selw;
-				} else if (a[selw].heat) {
-					-- a[selw].LRUstackposition;
-				} else if (!a[selw].heat && a[selw].LRUstackposition > a[updateWayID].LRUstackposition) {
-					-- a[selw].LRUstackposition;
-				}
+				UINT32 hot(a[selw].heat != 0), z(hot & (a[selw].pst == 0));
+				zero_way = z ? selw : zero_way;
+				a[selw].pst -= (hot & !z) | (!hot & (a[selw].pst > a[uid].pst));
 			}
 			a[zero_way].heat = 0;
-			a[zero_way].LRUstackposition = assoc - cnt_hot[setIndex] - 1;
+			a[zero_way].LRUstackposition = assoc - cnt_hot - 1;
 			a[updateWayID].heat = 1;
-			a[updateWayID].LRUstackposition = cnt_hot[setIndex] - 1;
+			a[updateWayID].LRUstackposition = cnt_hot - 1;
 		} else {
 			for (UINT32 i = 0; i < assoc; ++ i) {
 				if (a[i].pst > a[uid].pst) {
 					-- a[i].pst;
 				}
 			}
-			a[uid].pst = assoc - cnt_hot[setIndex] - 1;
+			a[uid].pst = assoc - cnt_hot - 1;
 		}
 	}
 }
 void CACHE_REPLACEMENT_STATE::updateStride( UINT32 setIndex, INT32 updateWayID ) {
-	for (UINT32 way = 0; way < assoc; ++ way) {
-		repl[setIndex][way].location *= .8;
-	}
-	repl[setIndex][updateWayID].location += 1.;
+	LINE_REPLACEMENT_STATE* a = ReplSet(setIndex);
+	UINT32 now(++ MlruSet(setIndex)->decay_now);
+	a[uid].location = decayed(a[uid], now, true) + 1.;
+	a[uid].stamp = now;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -374,78 +553,390 @@ ostream & CACHE_REPLACEMENT_STATE::PrintStats(ostream &out)
     out<<"=========================================================="<<endl;
 
     // CONTESTANTS:  Insert your statistics printing here
+	if (replPolicy == CRC_REPL_OPT) {
+		out<<"OPT Bypasses: "<<optBypass<<endl;
+	}
+	if (replPolicy == CRC_REPL_MLRU) {
+		out<<"MLRU Bypasses: "<<MLRUBypasses()<<endl;
+	}
+	if (replPolicy == CRC_REPL_CONTESTANT) {
+		COUNTER counts[LIRSplus::COUNTS], temps[64];
+		SumLIRSplus(counts, temps);
+		for (int i = 0; i < LIRSplus::COUNTS; ++ i) {
+			out<<"LIRSplus "<<LIRSplus::countName(i)<<": "<<counts[i]<<endl;
+		}
+		out<<"LIRSplus Demotion Temperatures:";
+		for (int t = 0; t < 64; ++ t) {
+			if (temps[t]) {
+				out<<" "<<t<<":"<<temps[t];
+			}
+		}
+		out<<endl;
+		// The whole trajectory goes to the JSON only
+		if (numLirsSamples) {
+			const LIRS_SAMPLE &l(lirsSamples[numLirsSamples - 1]);
+			out<<"LIRSplus Threshold: mean "<<l.mean<<" low "<<l.low<<" high "<<l.high
+				<<" (last of "<<numLirsSamples<<" samples every "<<lirsInterval<<" accesses)"<<endl;
+		}
+	}
 
     return out;
     
 }
 
-INT32 CACHE_REPLACEMENT_STATE::getLIRSplusVictim( UINT32 setIndex, Addr_t pc, Addr_t pa, UINT32 acc_type ) {
-	LINE_REPLACEMENT_STATE *a = repl[setIndex];
-	int res(lirs[setIndex].getVictim(a, pa));
-	a[res].type = acc_type;
+ostream & CACHE_REPLACEMENT_STATE::PrintStatsJSON(ostream &out)
+{
+	out<<"{\"policy\": \""<<ops->name<<"\"";
+	if (replPolicy == CRC_REPL_OPT) {
+		out<<", \"optBypasses\": "<<optBypass;
+	}
+	if (replPolicy == CRC_REPL_MLRU) {
+		out<<", \"mlruBypasses\": "<<MLRUBypasses();
+	}
+	if (replPolicy == CRC_REPL_CONTESTANT) {
+		COUNTER counts[LIRSplus::COUNTS], temps[64];
+		SumLIRSplus(counts, temps);
+		out<<", \"lirsplus\": {";
+		for (int i = 0; i < LIRSplus::COUNTS; ++ i) {
+			out<<"\""<<LIRSplus::countKey(i)<<"\": "<<counts[i]<<", ";
+		}
+		out<<"\"demotionTemperatures\": [";
+		for (int t = 0; t < 64; ++ t) {
+			out<<(t ? ", " : "")<<temps[t];
+		}
+		out<<"], \"thresholdInterval\": "<<lirsInterval<<", \"threshold\": [";
+		for (UINT32 i = 0; i < numLirsSamples; ++ i) {
+			out<<(i ? ", " : "")<<"{\"time\": "<<lirsSamples[i].time<<", \"mean\": "<<lirsSamples[i].mean
+				<<", \"low\": "<<lirsSamples[i].low<<", \"high\": "<<lirsSamples[i].high<<"}";
+		}
+		out<<"]}";
+	}
+	return out<<"}"<<endl;
+}
+
+COUNTER CACHE_REPLACEMENT_STATE::MLRUBypasses() const {
+	COUNTER n(0);
+	for (UINT32 i = 0; i < numsets; ++ i) {
+		n += mlruBypass[i];
+	}
+	return n;
+}
+
+// Adds up the event counts and the demotion temperatures of all sets
+void CACHE_REPLACEMENT_STATE::SumLIRSplus( COUNTER *counts, COUNTER *temps ) {
+	std::fill(counts, counts + LIRSplus::COUNTS, 0);
+	std::fill(temps, temps + 64, 0);
+	for (UINT32 i = 0; i < numsets; ++ i) {
+		LIRSplus *l(Lirs(i));
+		for (int k = 0; k < LIRSplus::COUNTS; ++ k) {
+			counts[k] += l->counts[k];
+		}
+		for (int t = 0; t < 64; ++ t) {
+			temps[t] += l->temperatures()[t];
+		}
+	}
+}
+
+// Off the access path: runs once every lirsInterval accesses
+void CACHE_REPLACEMENT_STATE::SampleLIRSplus() {
+	if (numLirsSamples == LIRS_SAMPLES) {
+		// Full, keep the samples of the doubled interval
+		for (UINT32 i = 0; i < LIRS_SAMPLES / 2; ++ i) {
+			lirsSamples[i] = lirsSamples[2 * i + 1];
+		}
+		numLirsSamples = LIRS_SAMPLES / 2;
+		lirsInterval *= 2;
+	}
+	LIRS_SAMPLE &s(lirsSamples[numLirsSamples ++]);
+	s.time = mytimer;
+	s.low = s.high = Lirs(0)->threshold();
+	double sum(0);
+	for (UINT32 i = 0; i < numsets; ++ i) {
+		int t(Lirs(i)->threshold());
+		sum += t;
+		s.low = std::min(s.low, t);
+		s.high = std::max(s.high, t);
+	}
+	s.mean = sum / numsets;
+	nextLirsSample = (mytimer / lirsInterval + 1) * lirsInterval;
+}
+
+// Belady's OPT: evicts the line used furthest in the future, or bypasses
+// when the incoming line is used even later
+template <UINT32 ASSOC>
+INT32 CACHE_REPLACEMENT_STATE::getOPTVictim( UINT32 setIndex ) {
+	// Fixed associativity when compiled for one
+	const UINT32 assoc = ASSOC ? ASSOC : this->assoc;
+
+	OPT_LINE_STATE *a = Lines<OPT_LINE_STATE>(setIndex);
+	INT32 res(0);
+	for (UINT32 way = 1; way < assoc; ++ way) {
+		if (a[way].nextUse > a[res].nextUse) {
+			res = way;
+		}
+	}
+	if (nextUse >= a[res].nextUse) {
+		++ optBypass;
+		return -1;
+	}
 	return res;
 }
 
+INT32 CACHE_REPLACEMENT_STATE::getLIRSplusVictim( UINT32 setIndex, Addr_t pc, Addr_t pa, UINT32 acc_type ) {
+	return Lirs(setIndex)->getVictim(Lines<LIRS_LINE_STATE>(setIndex), pa);
+}
+
+// Way i in stack node i, way 0 LIR and the others HIR in the queue
+void CACHE_REPLACEMENT_STATE::initLIRSplus( UINT32 setIndex ) {
+	LIRS_LINE_STATE *a = Lines<LIRS_LINE_STATE>(setIndex);
+	for (UINT32 way = 0; way < assoc; ++ way) {
+		a[way].pa = 0;
+		a[way].pst = way;
+		a[way].pq = way - 1;
+		a[way].heat = 2 | (way == 0);
+	}
+	(new (Lirs(setIndex)) LIRSplus)->init(assoc, ghosts, (char*)Lirs(setIndex) + sizeof(LIRSplus));
+}
+
 void CACHE_REPLACEMENT_STATE::updateLIRSplus( UINT32 setIndex, INT32 updateWayID, Addr_t pc ) {
-	LINE_REPLACEMENT_STATE *a = repl[setIndex];
-	return lirs[setIndex].update(a, uid);
+	LIRS_LINE_STATE *a = Lines<LIRS_LINE_STATE>(setIndex);
+	return Lirs(setIndex)->update(a, uid);
+}
+
+// The stack nodes, the queue and the hash buckets follow the object in its
+// arena block; g non-resident entries at most on top of the n resident ones
+size_t LIRSplus::Bytes(int n, int g) {
+	int nodes(n + g);
+	return sizeof(LIRSplus) + nodes * (sizeof(Addr_t) + sizeof(int) + 5 * sizeof(short)) + n * 2 * sizeof(int)
+		+ (sizeof(short) << hashBits(nodes));
+}
+
+int LIRSplus::hashBits(int nodes) {
+	int b(1);
+	for (; (1 << b) < nodes; ++ b);
+	return b;
 }
 
-void LIRSplus::init(int _n) {
-	n = _n;
-	stc = new Addr_t[n * 3];
-	stp = new int[n * 3];
-	q = new int[qsz = n * 2];
+void LIRSplus::init(int _n, int _g, char* mem) {
+	n = _n, gmax = _g;
+	int nodes(n + gmax);
+	// Node links are shorts
+	assert(nodes <= 32767);
+	hbits = hashBits(nodes);
+	stc = (Addr_t*)mem;
+	stp = (int*)(stc + nodes);
+	q = stp + nodes;
+	sprev = (short*)(q + n * 2);
+	snext = sprev + nodes;
+	gprev = snext + nodes;
+	gnext = gprev + nodes;
+	hnext = gnext + nodes;
+	hhead = hnext + nodes;
+	for (int i = 0; i < (1 << hbits); ++ i) {
+		hhead[i] = -1;
+	}
+	qsz = n * 2;
 	for (int i = 0; i + 1 < n; ++ i) {
 		q[i] = i + 1;
 	}
 	qh = 0, qt = n - 1;
-	tst = n;
+	sbot = stop = -1, tst = 0;
+	gh = gt = -1, ghosts = 0;
+	// Way i in node i, which is its initial stack position
 	for (int i = 0; i < n; ++ i) {
-		stp[i] = i, stc[i] = 0;
+		push(0, i);
+	}
+}
+
+int LIRSplus::push(Addr_t pa, int w) {
+	assert(tst < n + gmax);
+	int p(tst ++);
+	stc[p] = pa;
+	stp[p] = w;
+	linkTop(p);
+	hashInsert(p);
+	return p;
+}
+
+void LIRSplus::linkTop(int p) {
+	sprev[p] = stop;
+	snext[p] = -1;
+	if (stop > -1) {
+		snext[stop] = p;
+	} else {
+		sbot = p;
+	}
+	stop = p;
+}
+
+void LIRSplus::unlink(int p) {
+	if (sprev[p] > -1) {
+		snext[sprev[p]] = snext[p];
+	} else {
+		sbot = snext[p];
 	}
+	if (snext[p] > -1) {
+		sprev[snext[p]] = sprev[p];
+	} else {
+		stop = sprev[p];
+	}
+}
+
+void LIRSplus::hashInsert(int p) {
+	short& h(hhead[hash(stc[p])]);
+	hnext[p] = h;
+	h = p;
+}
+
+// The link pointing at node p in its bucket
+short& LIRSplus::hashLink(int p) {
+	short* l(&hhead[hash(stc[p])]);
+	for (; *l != p; l = &hnext[*l]);
+	return *l;
+}
+
+void LIRSplus::hashRemove(int p) {
+	hashLink(p) = hnext[p];
+}
+
+// Non-resident entries queue up oldest first
+void LIRSplus::ghostAdd(int p) {
+	gprev[p] = gt;
+	gnext[p] = -1;
+	if (gt > -1) {
+		gnext[gt] = p;
+	} else {
+		gh = p;
+	}
+	gt = p;
+	++ ghosts;
+}
+
+void LIRSplus::ghostRemove(int p) {
+	if (gprev[p] > -1) {
+		gnext[gprev[p]] = gnext[p];
+	} else {
+		gh = gnext[p];
+	}
+	if (gnext[p] > -1) {
+		gprev[gnext[p]] = gprev[p];
+	} else {
+		gt = gprev[p];
+	}
+	-- ghosts;
+}
+
+void LIRSplus::rmNode(LIRS_LINE_STATE* a, int p) {
+	unlink(p);
+	hashRemove(p);
+	if (stp[p] == -1) {
+		ghostRemove(p);
+	}
+	int l(-- tst);
+	if (p == l) {
+		return;
+	}
+	// The last node in use fills the hole
+	hashLink(l) = p;
+	hnext[p] = hnext[l];
+	stc[p] = stc[l], stp[p] = stp[l];
+	sprev[p] = sprev[l], snext[p] = snext[l];
+	if (sprev[p] > -1) {
+		snext[sprev[p]] = p;
+	} else {
+		sbot = p;
+	}
+	if (snext[p] > -1) {
+		sprev[snext[p]] = p;
+	} else {
+		stop = p;
+	}
+	if (stp[p] > -1) {
+		a[stp[p]].pst = p;
+		return;
+	}
+	gprev[p] = gprev[l], gnext[p] = gnext[l];
+	if (gprev[p] > -1) {
+		gnext[gprev[p]] = p;
+	} else {
+		gh = p;
+	}
+	if (gnext[p] > -1) {
+		gprev[gnext[p]] = p;
+	} else {
+		gt = p;
+	}
+}
+
+void LIRSplus::rmBottom(LIRS_LINE_STATE* a) {
+	rmNode(a, sbot);
+}
+
+// The stack entry of the address closest to the bottom, -1 if none
+int LIRSplus::find(Addr_t pa) {
+	int m(-1);
+	for (int i = hhead[hash(pa)]; i > -1; i = hnext[i]) {
+		if (stc[i] == pa) {
+			if (m > -1) {
+				// Several entries of the address, take the bottom one
+				for (m = sbot; stc[m] != pa; m = snext[m]);
+				break;
+			}
+			m = i;
+		}
+	}
+	return m;
 }
 
-INT32 LIRSplus::getVictim(LRS* a, Addr_t pa) {
+INT32 LIRSplus::getVictim(LIRS_LINE_STATE* a, Addr_t pa) {
 	int res(q[qh]);
 	if (a[res].heat & 2) {
-		stp[a[res].pst] = -1;
+		int p(a[res].pst);
+		stp[p] = -1;
+		ghostAdd(p);
+		// Bounded history: the oldest non-resident entry goes
+		if (ghosts > gmax) {
+			++ counts[GHOST_DROPS];
+			rmNode(a, gh);
+		}
 	}
 	qh = qnext(qh);
 	a[res].pa = pa;
-	for (int i = 0; i < tst; ++ i) {
-		if (stc[i] == pa) {
-			a[res].pst = i;
-			a[res].heat = 3;
-			stp[i] = res;
-			moveToTop(a, res);
-			rmButton(a, 1);
-			return res;
+	int m(find(pa));
+	if (m > -1) {
+		if (stp[m] == -1) {
+			++ counts[GHOST_HITS];
+			ghostRemove(m);
 		}
+		a[res].pst = m;
+		a[res].heat = 3;
+		stp[m] = res;
+		moveToTop(a, res);
+		rmButton(a, 1);
+		return res;
 	}
 	a[res].heat = 2;
-	a[res].pst = tst;
-	stc[tst] = pa;
-	stp[tst ++] = res;
+	a[res].pst = push(pa, res);
 	q[a[res].pq = qt] = res;
 	qt = qnext(qt);
 	return res;
 }
 
-void LIRSplus::moveToTop(LRS* a, int w) {
+void LIRSplus::moveToTop(LIRS_LINE_STATE* a, int w) {
 	int p(a[w].pst);
-	for (; p + 1 < tst; ++ p) {
-		stc[p] = stc[p + 1];
-		stp[p] = stp[p + 1];
-		if (stp[p] > -1) {
-			a[stp[p]].pst = p;
-		}
+	if (p != stop) {
+		unlink(p);
+		linkTop(p);
 	}
-	stc[a[w].pst = tst - 1] = a[w].pa;
-	stp[tst - 1] = w;
+	if (stc[p] != a[w].pa) {
+		hashRemove(p);
+		stc[p] = a[w].pa;
+		hashInsert(p);
+	}
+	stp[p] = w;
 }
 
-void LIRSplus::rmFromQueue(LRS* a, int p) {
+void LIRSplus::rmFromQueue(LIRS_LINE_STATE* a, int p) {
 	for (; qnext(p) != qt; p = qnext(p)) {
 		q[p] = q[qnext(p)];
 		a[q[p]].pq = p;
@@ -453,36 +944,28 @@ void LIRSplus::rmFromQueue(LRS* a, int p) {
 	qt = qprev(qt);
 }
 
+// The lowest of the highest bits in which pa differs from a stack address,
+// -1 if it is on the stack. The highest bit is monotonic in the xor, so it
+// is the highest bit of the smallest xor: a min reduction the compiler
+// vectorizes, then one clz.
 int LIRSplus::getTempreture(Addr_t pa) {
-	int res(63);
+	Addr_t x(~0ull);
 	for (int i = 0; i < tst; ++ i) {
-		int s;
-		for (s = 63; s >= 0; -- s) {
-			if (((pa ^ stc[i]) >> s) & 1) {
-				break;
-			}
-		}
-		res = std::min(res, s);
+		x = std::min(x, pa ^ stc[i]);
 	}
-	return res;
+	return x ? 63 - __builtin_clzll(x) : -1;
 }
 
-void LIRSplus::rmButton(LRS* a, int frp) {
-	int rmi(stp[0]);
-	for (int p = 0; p + 1 < tst; ++ p) {
-		stc[p] = stc[p + 1];
-		stp[p] = stp[p + 1];
-		if (stp[p] > -1) {
-			a[stp[p]].pst = p;
-		}
-	}
-	-- tst;
+void LIRSplus::rmButton(LIRS_LINE_STATE* a, int frp) {
+	int rmi(stp[sbot]);
+	rmBottom(a);
 	if (rmi > -1) {
 		a[q[qt] = rmi].heat = 0;
 		int temp(getTempreture(a[rmi].pa));
 		adjustTempreture(temp);
-		// fprintf(stderr, "%d\n", getTempreture(a[rmi].pa));
+		++ counts[DEMOTIONS];
 		if (temp > temp_thres) {
+			++ counts[HOT_DEMOTIONS];
 			a[rmi].pq = qh = qprev(qh);
 		} else {
 			a[rmi].pq = qt;
@@ -502,15 +985,25 @@ void LIRSplus::adjustTempreture(int t) {
 		for (temp_thres = 0; s < (cnt >> 1) && temp_thres < 30; ++ temp_thres) {
 			s += temp_cnt[temp_thres];
 		}
-		fprintf(stderr, "%d\n", temp_thres);
 	}
 }
 
-void LIRSplus::update(LRS* a, int w) {
+const char* LIRSplus::countName(int i) {
+	static const char* names[COUNTS] = { "Demotions", "Hot Demotions", "Promotions", "Ghost Hits", "Ghost Drops" };
+	return names[i];
+}
+
+const char* LIRSplus::countKey(int i) {
+	static const char* keys[COUNTS] = { "demotions", "hotDemotions", "promotions", "ghostHits", "ghostDrops" };
+	return keys[i];
+}
+
+void LIRSplus::update(LIRS_LINE_STATE* a, int w) {
 	if (a[w].heat & 1) { // is LIR
 		moveToTop(a, w);
 		rmHIR(a);
 	} else if (a[w].heat & 2) { // is HIR in stack
+		++ counts[PROMOTIONS];
 		rmFromQueue(a, a[w].pq);
 		a[w].heat |= 1;
 		moveToTop(a, w);
@@ -518,28 +1011,35 @@ void LIRSplus::update(LRS* a, int w) {
 		rmButton(a);
 	} else { // is HIR beyond stack
 		a[w].heat |= 2;
-		stc[a[w].pst = tst] = a[w].pa;
-		stp[tst ++] = w;
+		a[w].pst = push(a[w].pa, w);
 	}
 }
 
-void LIRSplus::rmHIR(LRS* a) {
+void LIRSplus::rmHIR(LIRS_LINE_STATE* a) {
 	while (tst > 0) {
-		int rmi(stp[0]);
+		int rmi(stp[sbot]);
 		if (rmi > -1) {
 			if (a[rmi].heat & 1) {
 				break;
 			}
 			a[rmi].heat &= ~2;
 		}
-		for (int i = 0; i + 1 < tst; ++ i) {
-			stc[i] = stc[i + 1];
-			stp[i] = stp[i + 1];
-			if (stp[i] > -1) {
-				a[stp[i]].pst = i;
-			}
-		}
-		-- tst;
+		rmBottom(a);
 	}
 }
 
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// The per-way kernels for the generic and the specialized associativities   //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+#define CRC_INSTANTIATE_KERNELS(ASSOC) \
+    template INT32 CACHE_REPLACEMENT_STATE::Get_Random_Victim<ASSOC>( UINT32 ); \
+    template INT32 CACHE_REPLACEMENT_STATE::Get_LRU_Victim<ASSOC>( UINT32 ); \
+    template void  CACHE_REPLACEMENT_STATE::UpdateLRU<ASSOC>( UINT32, INT32 ); \
+    template INT32 CACHE_REPLACEMENT_STATE::getMLRUVictim<ASSOC>( UINT32, Addr_t, Addr_t ); \
+    template void  CACHE_REPLACEMENT_STATE::updateMLRU<ASSOC>( UINT32, INT32, Addr_t ); \
+    template INT32 CACHE_REPLACEMENT_STATE::getOPTVictim<ASSOC>( UINT32 );
+
+CRC_INSTANTIATE_KERNELS(0)
+CRC_SPECIALIZED_ASSOC(CRC_INSTANTIATE_KERNELS)
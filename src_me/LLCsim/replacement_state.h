@@ -23,8 +23,14 @@
 #include <cmath>
 #include <algorithm>
 #include <map>
+#include <new>
 #include "utils.h"
 #include "crc_cache_defs.h"
+#include "arena.h"
+
+// Associativities the access path is compiled for, besides the generic
+// code for any associativity (see CRC_CACHE_T)
+#define CRC_SPECIALIZED_ASSOC(X) X(4) X(8) X(16) X(32)
 
 // Replacement Policies Supported
 typedef enum 
@@ -32,15 +38,21 @@ typedef enum
     CRC_REPL_LRU        = 0,
     CRC_REPL_RANDOM     = 1,
     CRC_REPL_CONTESTANT = 2,
-    CRC_REPL_MLRU        = 3
+    CRC_REPL_MLRU        = 3,
+    CRC_REPL_OPT        = 4
 } ReplacemntPolicy;
 
+struct CRC_POLICY_OPS;
+
 // Replacement State Per Cache Line
 typedef struct
 {
     UINT32  LRUstackposition;
 
     // CONTESTANTS: Add extra state per cache line here
+	// MLRU and stride scores decay lazily: location is the score at decay
+	// tick stamp of the set, later ticks scale it when it is read
+	UINT32 stamp;
 	double location;
 
 	UINT32 heat;
@@ -50,6 +62,36 @@ typedef struct
 	INT32 type;
 } LINE_REPLACEMENT_STATE, LRS;
 
+// Only the state of the active policy is allocated. LRS is what MLRU (and
+// the stride helper) keep per line, the other policies need less:
+
+// True LRU of sets wider than the packed order
+typedef struct
+{
+    UINT32  LRUstackposition;
+} LRU_LINE_STATE;
+
+// LIRSplus: pst is the stack node of the way, pq its queue slot
+typedef struct
+{
+	Addr_t pa;
+	INT32 LRUstackposition;
+	UINT32 pq : 30, heat : 2;
+} LIRS_LINE_STATE;
+
+// OPT: index of the next access to the line, ~0 if there is none
+typedef struct
+{
+	COUNTER nextUse;
+} OPT_LINE_STATE;
+
+// MLRU per set: the hot ways and the decay tick of the scores
+typedef struct
+{
+	UINT32 cnt_hot;
+	UINT32 decay_now;
+} MLRU_SET_STATE;
+
 // The implementation for the cache replacement policy
 class CACHE_REPLACEMENT_STATE
 {
@@ -58,8 +100,38 @@ class CACHE_REPLACEMENT_STATE
     UINT32 numsets;
     UINT32 assoc;
     UINT32 replPolicy;
+
+    // Victim selection and update of replPolicy, from the policy registry
+    const CRC_POLICY_OPS *ops;
     
-    LINE_REPLACEMENT_STATE   **repl;
+    // Per-set state in the blocks of the arena, replOffset bytes in: a
+    // word of per-set state (the packed LRU order for LRU), the line states
+    // of the policy, then for LIRSplus its object with the stacks and queue.
+    // How much of each block that is depends on the policy, see SetBytes.
+    SET_ARENA *arena;
+    bool      ownArena;
+    size_t    replOffset;
+
+    // Depth of the LIRSplus non-resident history per set
+    UINT32    ghosts;
+
+    // LIRSplus threshold trajectory: every lirsInterval accesses the mean,
+    // lowest and highest temp_thres over the sets go into a preallocated
+    // buffer, which keeps every other sample and doubles the interval once
+    // it is full
+    struct LIRS_SAMPLE
+    {
+        COUNTER time;
+        double  mean;
+        INT32   low, high;
+    };
+
+    static const UINT32 LIRS_SAMPLES = 256;
+
+    LIRS_SAMPLE *lirsSamples;
+    UINT32      numLirsSamples;
+    COUNTER     lirsInterval;
+    COUNTER     nextLirsSample;
 
     COUNTER mytimer;  // tracks # of references to the cache
 
@@ -67,39 +139,107 @@ class CACHE_REPLACEMENT_STATE
 
   public:
 
+    // Statically dispatched policies, defined below the class. DYNAMIC
+    // dispatches at run time to the policy selected by replPolicy.
+    struct LRU;
+    struct RANDOM;
+    struct LIRSPLUS;
+    struct MLRU;
+    struct OPT;
+    struct DYNAMIC;
+
     // The constructor CAN NOT be changed
     CACHE_REPLACEMENT_STATE( UINT32 _sets, UINT32 _assoc, UINT32 _pol );
+    CACHE_REPLACEMENT_STATE( UINT32 _sets, UINT32 _assoc, UINT32 _pol, SET_ARENA *_arena, size_t _offset, UINT32 _ghosts=0 );
+    ~CACHE_REPLACEMENT_STATE();
+
+    // Bytes of arena set block the state of one set takes under policy pol,
+    // with a LIRSplus history of the given depth (0 for the default)
+    static size_t SetBytes( UINT32 pol, UINT32 assoc, UINT32 ghosts=0 );
+
+    // The LIRSplus history depth a request of ghosts entries gets: one entry
+    // unless given, as no more than one non-resident entry is ever alive (a
+    // fill prunes the stack down to the single LIR line, see lirscheck.cpp)
+    static UINT32 GhostDepth( UINT32 ghosts ) { return ghosts ? ghosts : 1; }
 
     INT32  GetVictimInSet( UINT32 tid, UINT32 setIndex, const LINE_STATE *vicSet, UINT32 assoc, Addr_t PC, Addr_t paddr, UINT32 accessType );
     void   UpdateReplacementState( UINT32 setIndex, INT32 updateWayID );
 
-    void   SetReplacementPolicy( UINT32 _pol ) { replPolicy = _pol; } 
-    void   IncrementTimer() { mytimer++; } 
+    void   SetReplacementPolicy( UINT32 _pol );
+    void   IncrementTimer( COUNTER n = 1 ) 
+    { 
+        mytimer += n; 
+        if( mytimer >= nextLirsSample ) SampleLIRSplus();
+    } 
+
+    // The timer value at which IncrementTimer next samples the policy
+    // state, ~0 if it never does
+    COUNTER NextSample() const { return nextLirsSample; }
+
+    // OPT needs to be told the next use of every access before it is made
+    void   SetNextUse( COUNTER n ) { nextUse = n; } 
 
     void   UpdateReplacementState( UINT32 setIndex, INT32 updateWayID, const LINE_STATE *currLine, 
                                    UINT32 tid, Addr_t PC, UINT32 accessType, bool cacheHit );
 
     ostream&   PrintStats( ostream &out);
 
+    // The policy internals PrintStats reports, as one JSON object
+    ostream&   PrintStatsJSON( ostream &out );
+
   private:
     
+    static size_t LirsOffset( UINT32 assoc ) { return SET_ARENA::Align( sizeof(BITVECTOR) + assoc * sizeof(LIRS_LINE_STATE), 8 ); }
+
+    // True LRU of sets with up to PACKED_LRU_WAYS ways is a permutation
+    // packed in one word: nibble p holds the way at stack position p, MRU
+    // first. Wider sets keep LRUstackposition per way.
+    static const UINT32 PACKED_LRU_WAYS = 16;
+
+    BITVECTOR      *LruOrder( UINT32 setIndex ) { return (BITVECTOR *)(arena->Set( setIndex ) + replOffset); }
+    MLRU_SET_STATE *MlruSet( UINT32 setIndex )  { return (MLRU_SET_STATE *)(arena->Set( setIndex ) + replOffset); }
+
+    // The line states of a set, of the type of the active policy
+    template <class LINE> LINE *Lines( UINT32 setIndex ) { return (LINE *)(arena->Set( setIndex ) + replOffset + sizeof(BITVECTOR)); }
+    LINE_REPLACEMENT_STATE *ReplSet( UINT32 setIndex ) { return Lines<LINE_REPLACEMENT_STATE>( setIndex ); }
+    class LIRSplus *Lirs( UINT32 setIndex ) { return (class LIRSplus *)(arena->Set( setIndex ) + replOffset + LirsOffset( assoc )); }
+
     void   InitReplacementState();
-    INT32  Get_Random_Victim( UINT32 setIndex );
+    void   InitPolicy();
+    void   InitSets();
 
-    INT32  Get_LRU_Victim( UINT32 setIndex );
-    void   UpdateLRU( UINT32 setIndex, INT32 updateWayID );
+    void   SampleLIRSplus();
+    void   SumLIRSplus( COUNTER *counts, COUNTER *temps );
+
+    // The per-way loops are compiled for a fixed associativity ASSOC, or
+    // for the run-time one when ASSOC is 0
+    template <UINT32 ASSOC> INT32  Get_Random_Victim( UINT32 setIndex );
+
+    template <UINT32 ASSOC> INT32  Get_LRU_Victim( UINT32 setIndex );
+    template <UINT32 ASSOC> void   UpdateLRU( UINT32 setIndex, INT32 updateWayID );
 
 	void updateStride(UINT32 setIndex, INT32 updateWayID);
     INT32  getStrideVictim( UINT32 setIndex, Addr_t pc, Addr_t pa );
 
-	UINT32* cnt_hot;
-	int cnt_miss, last_vic;
-	void updateMLRU(UINT32 setIndex, INT32 updateWayID, Addr_t);
-    INT32  getMLRUVictim( UINT32 setIndex , Addr_t, Addr_t);
+	double decayed(const LRS& l, UINT32 now, bool stride) const;
+
+	// Set between victim selection and the following update of the same
+	// set; kept per set so that disjoint sets never share mutable state
+	bool* last_vic;
+	// Misses MLRU bypassed for want of a cold way at the bottom, per set
+	// for the same reason
+	COUNTER* mlruBypass;
+	COUNTER MLRUBypasses() const;
+	void initMLRU(UINT32 setIndex);
+	template <UINT32 ASSOC> void updateMLRU(UINT32 setIndex, INT32 updateWayID, Addr_t);
+    template <UINT32 ASSOC> INT32  getMLRUVictim( UINT32 setIndex , Addr_t, Addr_t);
 
-	class LIRSplus* lirs;
+	void initLIRSplus(UINT32 setIndex);
 	void updateLIRSplus(UINT32 setIndex, INT32 updateWayID, Addr_t);
     INT32  getLIRSplusVictim( UINT32 setIndex , Addr_t, Addr_t, UINT32 );
+
+	COUNTER nextUse, optBypass;
+    template <UINT32 ASSOC> INT32  getOPTVictim( UINT32 setIndex );
 };
 
 class LIRSplus {
@@ -111,22 +251,70 @@ class LIRSplus {
 			qh = qt = 0, cnt = 0;
 			temp_thres = 38;
 			memset(temp_cnt, 0, sizeof(temp_cnt));
+			memset(counts, 0, sizeof(counts));
+		}
+		static size_t Bytes(int, int);
+		void init(int, int, char*);
+		INT32 getVictim(LIRS_LINE_STATE*, Addr_t);
+		void update(LIRS_LINE_STATE*, INT32);
+
+		// Event counts, indices into counts
+		enum {
+			DEMOTIONS,      // LIR to resident HIR
+			HOT_DEMOTIONS,  // of which queued in front
+			PROMOTIONS,     // resident HIR to LIR
+			GHOST_HITS,     // misses found in the non-resident history
+			GHOST_DROPS,    // non-resident entries dropped for room
+			COUNTS
+		};
+		COUNTER counts[COUNTS];
+		static const char* countName(int);
+		static const char* countKey(int);
+		int threshold() const {
+			return temp_thres;
 		}
-		~LIRSplus() {
-			delete [] this->q;
+		// Demotions per temperature, 64 of them
+		const int* temperatures() const {
+			return temp_cnt;
 		}
-		void init(int);
-		INT32 getVictim(LRS*, Addr_t);
-		void update(LRS*, INT32);
 	private:
 		int n, qsz;
+		// The LIRS stack is a doubly-linked list of pool nodes, bottom
+		// first: node i holds the address stc[i] and the way stp[i] (-1 for
+		// a non-resident one), pst of a way in the stack is its node. The
+		// tst nodes in use are kept at the front of the pool, so scans over
+		// the whole stack stay sequential.
 		Addr_t *stc;
 		int	*stp;
+		short *sprev, *snext;
+		int sbot, stop;
 		int tst;
-		void rmHIR(LRS*);
-		void moveToTop(LRS*, int);
-		void rmFromQueue(LRS*, int);
-		void rmButton(LRS*, int = 0);
+		// Non-resident entries, at most gmax of them, are also on a list
+		// from the oldest (gh) to the newest (gt); the oldest is dropped to
+		// make room. Every entry is chained into hash bucket of its address.
+		short *gprev, *gnext;
+		int gh, gt, ghosts, gmax;
+		short *hhead, *hnext;
+		int hbits;
+		static int hashBits(int);
+		inline int hash(Addr_t pa) {
+			return (int)((pa * 0x9E3779B97F4A7C15ull) >> (64 - hbits));
+		}
+		int push(Addr_t, int);
+		void linkTop(int);
+		void unlink(int);
+		void hashInsert(int);
+		short& hashLink(int);
+		void hashRemove(int);
+		void ghostAdd(int);
+		void ghostRemove(int);
+		void rmNode(LIRS_LINE_STATE*, int);
+		void rmBottom(LIRS_LINE_STATE*);
+		int find(Addr_t);
+		void rmHIR(LIRS_LINE_STATE*);
+		void moveToTop(LIRS_LINE_STATE*, int);
+		void rmFromQueue(LIRS_LINE_STATE*, int);
+		void rmButton(LIRS_LINE_STATE*, int = 0);
 		int getTempreture(Addr_t);
 		void adjustTempreture(int);
 		inline int qprev(int p) {
@@ -137,4 +325,237 @@ class LIRSplus {
 		}
 };
 
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Statically dispatched replacement policies. Each policy struct names the   //
+// victim selection and the update it runs on a CACHE_REPLACEMENT_STATE, and  //
+// whether it also wants to see writebacks that hit. CRC_CACHE_T<POLICY>      //
+// calls these directly, so no per-access dispatch is left; Victim and Update //
+// take the associativity they were compiled for (0 for any). A new policy is //
+// a struct here plus its entry in CRC_POLICIES, the registry used by the     //
+// run-time path is generated from that list.                                 //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+struct CACHE_REPLACEMENT_STATE::LRU
+{
+    static const UINT32 ID = CRC_REPL_LRU;
+    static const char *Name() { return "lru"; }
+
+    template <UINT32 ASSOC>
+    static INT32 Victim( CACHE_REPLACEMENT_STATE &s, UINT32 tid, UINT32 setIndex, const LINE_STATE *vicSet,
+                         Addr_t PC, Addr_t paddr, UINT32 accessType )
+    {
+        return s.Get_LRU_Victim<ASSOC>( setIndex );
+    }
+
+    template <UINT32 ASSOC>
+    static void Update( CACHE_REPLACEMENT_STATE &s, UINT32 setIndex, INT32 updateWayID, const LINE_STATE *currLine,
+                        UINT32 tid, Addr_t PC, UINT32 accessType, bool cacheHit )
+    {
+        s.UpdateLRU<ASSOC>( setIndex, updateWayID );
+    }
+
+    static bool WritebackHits( const CACHE_REPLACEMENT_STATE &s ) { return false; }
+
+    // The packed order, plus stack positions for sets too wide for it
+    static size_t SetBytes( UINT32 assoc, UINT32 ghosts )
+    {
+        return sizeof(BITVECTOR) + (assoc > PACKED_LRU_WAYS ? assoc * sizeof(LRU_LINE_STATE) : 0);
+    }
+
+    // Way p at stack position p
+    static void InitSet( CACHE_REPLACEMENT_STATE &s, UINT32 setIndex )
+    {
+        *s.LruOrder( setIndex ) = 0xFEDCBA9876543210ull;
+        if( s.assoc > PACKED_LRU_WAYS ) 
+        {
+            LRU_LINE_STATE *replSet = s.Lines<LRU_LINE_STATE>( setIndex );
+            for(UINT32 way=0; way<s.assoc; way++) replSet[ way ].LRUstackposition = way;
+        }
+    }
+};
+
+struct CACHE_REPLACEMENT_STATE::RANDOM
+{
+    static const UINT32 ID = CRC_REPL_RANDOM;
+    static const char *Name() { return "random"; }
+
+    template <UINT32 ASSOC>
+    static INT32 Victim( CACHE_REPLACEMENT_STATE &s, UINT32 tid, UINT32 setIndex, const LINE_STATE *vicSet,
+                         Addr_t PC, Addr_t paddr, UINT32 accessType )
+    {
+        return s.Get_Random_Victim<ASSOC>( setIndex );
+    }
+
+    // Random replacement requires no replacement state update
+    template <UINT32 ASSOC>
+    static void Update( CACHE_REPLACEMENT_STATE &s, UINT32 setIndex, INT32 updateWayID, const LINE_STATE *currLine,
+                        UINT32 tid, Addr_t PC, UINT32 accessType, bool cacheHit )
+    {
+    }
+
+    static bool WritebackHits( const CACHE_REPLACEMENT_STATE &s ) { return false; }
+
+    // No per-set state either
+    static size_t SetBytes( UINT32 assoc, UINT32 ghosts ) { return 0; }
+    static void   InitSet( CACHE_REPLACEMENT_STATE &s, UINT32 setIndex ) { }
+};
+
+// The contestant: only the update right after a victim is taken counts
+struct CACHE_REPLACEMENT_STATE::LIRSPLUS
+{
+    static const UINT32 ID = CRC_REPL_CONTESTANT;
+    static const char *Name() { return "lirsplus"; }
+
+    template <UINT32 ASSOC>
+    static INT32 Victim( CACHE_REPLACEMENT_STATE &s, UINT32 tid, UINT32 setIndex, const LINE_STATE *vicSet,
+                         Addr_t PC, Addr_t paddr, UINT32 accessType )
+    {
+		s.last_vic[setIndex] = true;
+		return s.getLIRSplusVictim(setIndex, PC, paddr, accessType);
+    }
+
+    template <UINT32 ASSOC>
+    static void Update( CACHE_REPLACEMENT_STATE &s, UINT32 setIndex, INT32 updateWayID, const LINE_STATE *currLine,
+                        UINT32 tid, Addr_t PC, UINT32 accessType, bool cacheHit )
+    {
+		if (s.last_vic[setIndex]) {
+			s.last_vic[setIndex] = false;
+			s.updateLIRSplus(setIndex, updateWayID, PC);
+		}
+    }
+
+    static bool WritebackHits( const CACHE_REPLACEMENT_STATE &s ) { return false; }
+
+    static size_t SetBytes( UINT32 assoc, UINT32 ghosts )
+    {
+        return LirsOffset( assoc ) + LIRSplus::Bytes( assoc, GhostDepth( ghosts ) );
+    }
+
+    static void InitSet( CACHE_REPLACEMENT_STATE &s, UINT32 setIndex ) { s.initLIRSplus( setIndex ); }
+};
+
+struct CACHE_REPLACEMENT_STATE::MLRU
+{
+    static const UINT32 ID = CRC_REPL_MLRU;
+    static const char *Name() { return "mlru"; }
+
+    template <UINT32 ASSOC>
+    static INT32 Victim( CACHE_REPLACEMENT_STATE &s, UINT32 tid, UINT32 setIndex, const LINE_STATE *vicSet,
+                         Addr_t PC, Addr_t paddr, UINT32 accessType )
+    {
+		return s.getMLRUVictim<ASSOC>(setIndex, PC, paddr);
+    }
+
+    template <UINT32 ASSOC>
+    static void Update( CACHE_REPLACEMENT_STATE &s, UINT32 setIndex, INT32 updateWayID, const LINE_STATE *currLine,
+                        UINT32 tid, Addr_t PC, UINT32 accessType, bool cacheHit )
+    {
+		s.updateMLRU<ASSOC>(setIndex, updateWayID, PC);
+    }
+
+    static bool WritebackHits( const CACHE_REPLACEMENT_STATE &s ) { return false; }
+
+    // The per-set word holds MLRU_SET_STATE
+    static size_t SetBytes( UINT32 assoc, UINT32 ghosts )
+    {
+        return sizeof(BITVECTOR) + assoc * sizeof(LINE_REPLACEMENT_STATE);
+    }
+
+    static void InitSet( CACHE_REPLACEMENT_STATE &s, UINT32 setIndex ) { s.initMLRU( setIndex ); }
+};
+
+// Belady's OPT, fed through SetNextUse; writebacks that hit are uses too
+struct CACHE_REPLACEMENT_STATE::OPT
+{
+    static const UINT32 ID = CRC_REPL_OPT;
+    static const char *Name() { return "opt"; }
+
+    template <UINT32 ASSOC>
+    static INT32 Victim( CACHE_REPLACEMENT_STATE &s, UINT32 tid, UINT32 setIndex, const LINE_STATE *vicSet,
+                         Addr_t PC, Addr_t paddr, UINT32 accessType )
+    {
+		return s.getOPTVictim<ASSOC>(setIndex);
+    }
+
+    template <UINT32 ASSOC>
+    static void Update( CACHE_REPLACEMENT_STATE &s, UINT32 setIndex, INT32 updateWayID, const LINE_STATE *currLine,
+                        UINT32 tid, Addr_t PC, UINT32 accessType, bool cacheHit )
+    {
+		s.Lines<OPT_LINE_STATE>(setIndex)[updateWayID].nextUse = s.nextUse;
+    }
+
+    static bool WritebackHits( const CACHE_REPLACEMENT_STATE &s ) { return true; }
+
+    static size_t SetBytes( UINT32 assoc, UINT32 ghosts )
+    {
+        return sizeof(BITVECTOR) + assoc * sizeof(OPT_LINE_STATE);
+    }
+
+    static void InitSet( CACHE_REPLACEMENT_STATE &s, UINT32 setIndex )
+    {
+        OPT_LINE_STATE *replSet = s.Lines<OPT_LINE_STATE>( setIndex );
+        for(UINT32 way=0; way<s.assoc; way++) replSet[ way ].nextUse = 0;
+    }
+};
+
+// Run-time view of a policy, generated from its struct
+struct CRC_POLICY_OPS
+{
+    UINT32     id;
+    const char *name;
+    INT32      (*victim)( CACHE_REPLACEMENT_STATE &, UINT32, UINT32, const LINE_STATE *, Addr_t, Addr_t, UINT32 );
+    void       (*update)( CACHE_REPLACEMENT_STATE &, UINT32, INT32, const LINE_STATE *, UINT32, Addr_t, UINT32, bool );
+    bool       (*writebackHits)( const CACHE_REPLACEMENT_STATE & );
+    size_t     (*setBytes)( UINT32, UINT32 );
+    void       (*initSet)( CACHE_REPLACEMENT_STATE &, UINT32 );
+};
+
+template <class... POLICIES>
+struct CRC_POLICY_LIST
+{
+    static const UINT32 COUNT = sizeof...(POLICIES);
+
+    static const CRC_POLICY_OPS *Ops()
+    {
+        static const CRC_POLICY_OPS ops[] = {
+            { POLICIES::ID, POLICIES::Name(), &POLICIES::template Victim<0>, &POLICIES::template Update<0>, &POLICIES::WritebackHits,
+              &POLICIES::SetBytes, &POLICIES::InitSet }...
+        };
+        return ops;
+    }
+};
+
+// The policy registry
+typedef CRC_POLICY_LIST< CACHE_REPLACEMENT_STATE::LRU,
+                         CACHE_REPLACEMENT_STATE::RANDOM,
+                         CACHE_REPLACEMENT_STATE::LIRSPLUS,
+                         CACHE_REPLACEMENT_STATE::MLRU,
+                         CACHE_REPLACEMENT_STATE::OPT > CRC_POLICIES;
+
+// Registry lookups by id, or by name or decimal id; NULL if unknown
+const CRC_POLICY_OPS *CRC_FindPolicy( UINT32 id );
+const CRC_POLICY_OPS *CRC_FindPolicy( const char *name );
+
+// Run-time dispatch through the registry, what the kit interface uses
+struct CACHE_REPLACEMENT_STATE::DYNAMIC
+{
+    template <UINT32 ASSOC>
+    static INT32 Victim( CACHE_REPLACEMENT_STATE &s, UINT32 tid, UINT32 setIndex, const LINE_STATE *vicSet,
+                         Addr_t PC, Addr_t paddr, UINT32 accessType )
+    {
+        return s.ops->victim( s, tid, setIndex, vicSet, PC, paddr, accessType );
+    }
+
+    template <UINT32 ASSOC>
+    static void Update( CACHE_REPLACEMENT_STATE &s, UINT32 setIndex, INT32 updateWayID, const LINE_STATE *currLine,
+                        UINT32 tid, Addr_t PC, UINT32 accessType, bool cacheHit )
+    {
+        s.ops->update( s, setIndex, updateWayID, currLine, tid, PC, accessType, cacheHit );
+    }
+
+    static bool WritebackHits( const CACHE_REPLACEMENT_STATE &s ) { return s.ops->writebackHits( s ); }
+};
+
 #endif
@@ -0,0 +1,182 @@
+#include <cstring>
+#include "shadow.h"
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// The shadow of a cache of capacity lines. The table starts at four slots    //
+// per line of the shadow and doubles as the footprint grows.                 //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+CRC_SHADOW::CRC_SHADOW( UINT32 _capacity )
+{
+    capacity  = _capacity;
+    numNodes  = 0;
+    head      = NONE;
+    tail      = NONE;
+    nodes     = new NODE[ capacity ];
+    wayNodes  = new INT32[ capacity ];
+
+    for(UINT32 i=0; i<capacity; i++) wayNodes[ i ] = NONE;
+
+    UINT32 bits = CRC_FloorLog2( capacity ) + 2;
+
+    mask      = ((size_t)1 << bits) - 1;
+    hashShift = 64 - bits;
+    used      = 0;
+    table     = new ENTRY[ mask + 1 ]();
+
+    ResetStats();
+}
+
+CRC_SHADOW::~CRC_SHADOW()
+{
+    delete [] table;
+    delete [] nodes;
+    delete [] wayNodes;
+}
+
+void CRC_SHADOW::ResetStats()
+{
+    memset( counts, 0, sizeof(counts) );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// The slot of line in the table, or the empty slot it would go to            //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+CRC_SHADOW::ENTRY * CRC_SHADOW::Find( Addr_t line )
+{
+    size_t i = Hash( line );
+
+    while( table[ i ].key && table[ i ].key != line + 1 )
+    {
+        i = (i + 1) & mask;
+    }
+
+    return table + i;
+}
+
+void CRC_SHADOW::Grow()
+{
+    ENTRY  *old     = table;
+    size_t oldSlots = mask + 1;
+
+    mask      = 2 * oldSlots - 1;
+    hashShift--;
+    table     = new ENTRY[ mask + 1 ]();
+
+    for(size_t i=0; i<oldSlots; i++)
+    {
+        if( old[ i ].key )
+        {
+            *Find( old[ i ].key - 1 ) = old[ i ];
+        }
+    }
+
+    delete [] old;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// The LRU list of the shadow                                                 //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+void CRC_SHADOW::Unlink( INT32 n )
+{
+    NODE &node = nodes[ n ];
+
+    if( node.prev != NONE ) nodes[ node.prev ].next = node.next;
+    else                    head                    = node.next;
+
+    if( node.next != NONE ) nodes[ node.next ].prev = node.prev;
+    else                    tail                    = node.prev;
+}
+
+void CRC_SHADOW::PushHead( INT32 n )
+{
+    nodes[ n ].prev = NONE;
+    nodes[ n ].next = head;
+
+    if( head != NONE ) nodes[ head ].prev = n;
+    else               tail               = n;
+
+    head = n;
+}
+
+void CRC_SHADOW::Touch( INT32 n )
+{
+    if( n != head )
+    {
+        Unlink( n );
+        PushHead( n );
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Classifies the access by the state of its line before it, then makes it    //
+// in the shadow: a hit moves the node of the line to the head, a miss takes  //
+// a free node or the LRU one, whose line leaves the shadow. A hit of the     //
+// real cache only needs the node, which the way remembers unless the line    //
+// left the shadow since it was made.                                         //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+void CRC_SHADOW::Record( Addr_t line, UINT32 accessType, bool hit, INT32 lineIndex )
+{
+    if( hit && lineIndex >= 0 )
+    {
+        INT32 n = wayNodes[ lineIndex ];
+
+        if( Holds( n, line ) )
+        {
+            Touch( n );
+            return;
+        }
+    }
+
+    ENTRY *e = Find( line );
+
+    if( !e->key )
+    {
+        if( !hit ) counts[ accessType ][ COMPULSORY ]++;
+
+        e->key  = line + 1;
+        e->node = NONE;
+
+        if( 2 * ++used > mask + 1 )
+        {
+            Grow();
+            e = Find( line );
+        }
+    }
+    else if( !hit )
+    {
+        counts[ accessType ][ Holds( e->node, line ) ? CONFLICT : CAPACITY ]++;
+    }
+
+    INT32 n = e->node;
+
+    if( Holds( n, line ) )
+    {
+        Touch( n );
+    }
+    else
+    {
+        if( numNodes < capacity )
+        {
+            n = numNodes++;
+        }
+        else
+        {
+            n = tail;
+            Unlink( n );
+        }
+
+        nodes[ n ].line = line;
+        PushHead( n );
+        e->node = n;
+    }
+
+    if( lineIndex >= 0 ) wayNodes[ lineIndex ] = n;
+}
@@ -0,0 +1,91 @@
+#ifndef SHADOW_H
+#define SHADOW_H
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Three-C classification of the misses of a cache. The shadow is a fully     //
+// associative LRU cache of the same number of lines, fed every access. A     //
+// miss of the real cache is compulsory if its line was never accessed        //
+// before, a capacity miss if the shadow misses too, and a conflict miss      //
+// otherwise.                                                                 //
+//                                                                            //
+// One open-addressing table of every line ever accessed serves as both the   //
+// first-touch set and the map of the shadow: an entry holds the node the     //
+// line last had in the LRU list, which is still its own while the node       //
+// holds the line, so an eviction from the shadow leaves the table alone. All //
+// updates are O(1). The shadow also remembers the node of the line in each   //
+// way of the real cache, so a hit of the real cache on a line still in the   //
+// shadow moves its node without probing the table.                           //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+#include "utils.h"
+#include "crc_cache_defs.h"
+
+class CRC_SHADOW
+{
+  public:
+
+    enum { COMPULSORY, CAPACITY, CONFLICT, KINDS };
+
+    CRC_SHADOW( UINT32 _capacity );
+    ~CRC_SHADOW();
+
+    // Moves line to the MRU end of the shadow, and counts the miss of the
+    // real cache by kind unless it hit. lineIndex is where the real cache
+    // holds line (set * assoc + way, -1 for a bypass).
+    void Record( Addr_t line, UINT32 accessType, bool hit, INT32 lineIndex );
+
+    // The table slot of line, before its access
+    void Prefetch( Addr_t line ) { __builtin_prefetch( table + Hash( line ) ); }
+
+    COUNTER Misses( UINT32 accessType, UINT32 kind ) { return counts[ accessType ][ kind ]; }
+    void    ResetStats();
+
+  private:
+
+    static const INT32 NONE = -1;
+
+    // line + 1, so that a zero key is an empty slot
+    struct ENTRY
+    {
+        Addr_t key;
+        INT32  node;
+    };
+
+    struct NODE
+    {
+        Addr_t line;
+        INT32  prev;
+        INT32  next;
+    };
+
+    // The table, mask + 1 slots, at most half of them used
+    ENTRY   *table;
+    size_t  mask;
+    size_t  used;
+    UINT32  hashShift;
+
+    // The LRU list of the shadow, most recent at head
+    NODE    *nodes;
+    UINT32  capacity;
+    UINT32  numNodes;
+    INT32   head;
+    INT32   tail;
+
+    // The node of the line in each way of the real cache, when it was made
+    INT32   *wayNodes;
+
+    COUNTER counts[ ACCESS_MAX ][ KINDS ];
+
+    size_t  Hash( Addr_t line ) { return (size_t)((line * 0x9E3779B97F4A7C15ull) >> hashShift); }
+    ENTRY  *Find( Addr_t line );
+    void    Grow();
+
+    void    Unlink( INT32 n );
+    void    PushHead( INT32 n );
+    void    Touch( INT32 n );
+    bool    Holds( INT32 n, Addr_t line ) { return n != NONE && nodes[ n ].line == line; }
+};
+
+#endif
@@ -0,0 +1,184 @@
+#include <cassert>
+#include <cstring>
+#include "telemetry.h"
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// The sets of a cache with indexBits of set index, snapshots of interval     //
+// accesses, the last capacity of them kept                                   //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+CRC_TELEMETRY::CRC_TELEMETRY( UINT32 _indexBits, COUNTER _interval, UINT32 _capacity )
+{
+    sets        = 1u << _indexBits;
+    buckets     = sets < BUCKETS ? sets : BUCKETS;
+    bucketShift = _indexBits - CRC_FloorLog2( buckets );
+    interval    = _interval;
+    capacity    = _capacity;
+
+    // The counters of an interval must not wrap
+    assert( interval > 0 && interval <= 0xffffffffull );
+
+    setCounts  = new UINT32[ 3 * sets ];
+    setTotals  = new COUNTER[ 3 * sets ];
+    ring       = new INTERVAL[ capacity ];
+    ringMisses = new COUNTER[ (size_t)capacity * buckets ];
+
+    ResetStats();
+}
+
+CRC_TELEMETRY::~CRC_TELEMETRY()
+{
+    delete [] setCounts;
+    delete [] setTotals;
+    delete [] ring;
+    delete [] ringMisses;
+}
+
+void CRC_TELEMETRY::ResetStats()
+{
+    memset( setCounts, 0, 3 * sets * sizeof(UINT32) );
+    memset( setTotals, 0, 3 * sets * sizeof(COUNTER) );
+
+    numSnapshots = 0;
+    dropped      = 0;
+    start        = 0;
+    curAccesses  = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// The current interval and its misses per group of sets                      //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+void CRC_TELEMETRY::Current( INTERVAL &iv, COUNTER *misses )
+{
+    UINT32 width = 1u << bucketShift;
+
+    iv.start     = start;
+    iv.accesses  = curAccesses;
+    iv.misses    = 0;
+    iv.evictions = 0;
+
+    for(UINT32 b=0; b<buckets; b++)
+    {
+        const UINT32 *counts = setCounts + 3 * (size_t)b * width;
+
+        misses[ b ] = 0;
+        for(UINT32 s=0; s<width; s++)
+        {
+            misses[ b ]  += counts[ 3*s + FILLING ] + counts[ 3*s + EVICTING ];
+            iv.evictions += counts[ 3*s + EVICTING ];
+        }
+
+        iv.misses += misses[ b ];
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Closes the current interval into the ring, over the oldest snapshot once   //
+// the ring is full, and moves the counters of the sets to their totals       //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+void CRC_TELEMETRY::Snapshot()
+{
+    UINT32 slot = (UINT32)((numSnapshots + dropped) % capacity);
+
+    Current( ring[ slot ], ringMisses + (size_t)slot * buckets );
+
+    if( numSnapshots < capacity ) numSnapshots++;
+    else                          dropped++;
+
+    for(UINT32 i=0; i<3 * sets; i++) setTotals[ i ] += setCounts[ i ];
+    memset( setCounts, 0, 3 * sets * sizeof(UINT32) );
+
+    start       += curAccesses;
+    curAccesses = 0;
+}
+
+template <class F>
+void CRC_TELEMETRY::ForIntervals( F f )
+{
+    for(UINT32 i=0; i<numSnapshots; i++)
+    {
+        UINT32 slot = (UINT32)((dropped + i) % capacity);
+
+        f( ring[ slot ], ringMisses + (size_t)slot * buckets );
+    }
+
+    if( curAccesses )
+    {
+        INTERVAL cur;
+        COUNTER  *misses = new COUNTER[ buckets ];
+
+        Current( cur, misses );
+        f( cur, misses );
+
+        delete [] misses;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// The telemetry as CSV tables or as one JSON object                          //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+ostream & CRC_TELEMETRY::WriteSetsCSV( ostream &out )
+{
+    out<<"set,hits,misses,evictions"<<endl;
+    for(UINT32 s=0; s<sets; s++)
+    {
+        out<<s<<","<<SetCount( s, 0 )<<","<<SetCount( s, 1 )<<","<<SetCount( s, 2 )<<endl;
+    }
+
+    return out;
+}
+
+ostream & CRC_TELEMETRY::WriteIntervalsCSV( ostream &out )
+{
+    UINT32 width = 1u << bucketShift;
+
+    out<<"start,accesses,misses,evictions";
+    for(UINT32 b=0; b<buckets; b++)
+    {
+        out<<",sets_"<<b * width<<"_"<<(b + 1) * width - 1;
+    }
+    out<<endl;
+
+    UINT32 n = buckets;
+    ForIntervals( [&out, n]( const INTERVAL &iv, const COUNTER *misses ) {
+        out<<iv.start<<","<<iv.accesses<<","<<iv.misses<<","<<iv.evictions;
+        for(UINT32 b=0; b<n; b++) out<<","<<misses[ b ];
+        out<<endl;
+    } );
+
+    return out;
+}
+
+ostream & CRC_TELEMETRY::WriteJSON( ostream &out )
+{
+    static const char *names[] = { "hits", "misses", "evictions" };
+
+    out<<"{\"interval\": "<<interval<<", \"setsPerBucket\": "<<(1u << bucketShift)
+       <<", \"droppedIntervals\": "<<dropped<<", \"sets\": {";
+    for(UINT32 k=0; k<3; k++)
+    {
+        out<<(k ? ", " : "")<<"\""<<names[ k ]<<"\": [";
+        for(UINT32 s=0; s<sets; s++) out<<(s ? ", " : "")<<SetCount( s, k );
+        out<<"]";
+    }
+    out<<"}, \"intervals\": [";
+
+    bool first = true;
+    UINT32 n = buckets;
+    ForIntervals( [&out, &first, n]( const INTERVAL &iv, const COUNTER *misses ) {
+        out<<(first ? "" : ", ")<<"{\"start\": "<<iv.start<<", \"accesses\": "<<iv.accesses
+           <<", \"misses\": "<<iv.misses<<", \"evictions\": "<<iv.evictions<<", \"bucketMisses\": [";
+        for(UINT32 b=0; b<n; b++) out<<(b ? ", " : "")<<misses[ b ];
+        out<<"]}";
+        first = false;
+    } );
+
+    return out<<"]}"<<endl;
+}
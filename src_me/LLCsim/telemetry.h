@@ -0,0 +1,109 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Per-set and per-interval miss telemetry of a cache. Every set counts its   //
+// hits, misses and evictions. Every interval accesses the misses of the      //
+// interval, per group of sets, go into a preallocated ring of snapshots,     //
+// so phases show up as rows of a sets x time heatmap. The oldest snapshots   //
+// are overwritten once the ring is full.                                     //
+//                                                                            //
+// An access increments a single 32-bit counter of its set, which holds the   //
+// current interval only; a snapshot sums them per group of sets, adds them   //
+// to the 64-bit totals of the sets and clears them, in one pass over the     //
+// sets. An interval is thus at most 2^32 - 1 accesses.                       //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+#include "utils.h"
+
+class CRC_TELEMETRY
+{
+  public:
+
+    // Sets are grouped into at most BUCKETS columns of the heatmap
+    static const UINT32 BUCKETS = 64;
+
+    CRC_TELEMETRY( UINT32 _indexBits, COUNTER _interval, UINT32 _capacity );
+    ~CRC_TELEMETRY();
+
+    void Record( UINT32 setIndex, bool hit, bool evicted )
+    {
+        // Only misses evict, so the counter is picked without a branch
+        setCounts[ 3 * setIndex + (UINT32)!hit + (UINT32)evicted ]++;
+
+        if( ++curAccesses == interval )
+        {
+            Snapshot();
+        }
+    }
+
+    // The counters of a set, before its access
+    void Prefetch( UINT32 setIndex ) { __builtin_prefetch( setCounts + 3 * setIndex ); }
+
+    void ResetStats();
+
+    // The whole run: one row per set, one row per interval (the last one
+    // possibly partial) with a column per group of sets, or both as JSON
+    ostream & WriteSetsCSV( ostream &out );
+    ostream & WriteIntervalsCSV( ostream &out );
+    ostream & WriteJSON( ostream &out );
+
+  private:
+
+    struct INTERVAL
+    {
+        COUNTER start;
+        COUNTER accesses;
+        COUNTER misses;
+        COUNTER evictions;
+    };
+
+    UINT32  sets;
+    UINT32  buckets;
+    UINT32  bucketShift;
+    COUNTER interval;
+
+    // The hits, the misses that filled an invalid way and the misses that
+    // evicted a line of every set, an eviction one past the fill, in the
+    // current interval and up to its start
+    enum { HITS, FILLING, EVICTING };
+
+    UINT32  *setCounts;
+    COUNTER *setTotals;
+
+    // The hits, misses or evictions of set, k as in that order
+    COUNTER SetCount( UINT32 set, UINT32 k )
+    {
+        const UINT32  *counts = setCounts + 3 * (size_t)set;
+        const COUNTER *totals = setTotals + 3 * (size_t)set;
+
+        switch( k ) 
+        {
+            case 0:  return totals[ HITS ] + counts[ HITS ];
+            case 1:  return totals[ FILLING ] + counts[ FILLING ] + totals[ EVICTING ] + counts[ EVICTING ];
+            default: return totals[ EVICTING ] + counts[ EVICTING ];
+        }
+    }
+
+    // The ring: capacity snapshots, each with buckets misses in ringMisses
+    UINT32   capacity;
+    INTERVAL *ring;
+    COUNTER  *ringMisses;
+    UINT32   numSnapshots;
+    COUNTER  dropped;
+
+    // The interval being counted
+    COUNTER start;
+    COUNTER curAccesses;
+
+    void    Snapshot();
+    void    Current( INTERVAL &iv, COUNTER *misses );
+
+    // Calls f( interval, bucket misses ) for the snapshots in order and the
+    // current interval if it is not empty
+    template <class F> void ForIntervals( F f );
+};
+
+#endif
@@ -0,0 +1,400 @@
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Standalone trace-driven driver for CRC_CACHE. Accepts the options of       //
+// CMPsim.usetrace that matter to the LLC model:                              //
+//                                                                            //
+//   crcsim -threads 1 -t traces/sort.out.trace.gz -o sort.stats              //
+//          -cache UL3:1024:64:16 -LLCrepl 2                                  //
+//                                                                            //
+// -cache takes name:size(KB):linesize:assoc. The statistics file holds the   //
+// usual PrintStats report followed by the driver throughput. -async moves    //
+// trace decoding to its own thread.                                          //
+//                                                                            //
+// -intervals n -interval len -warmup len [-jobs n] estimates the run from n  //
+// sampled intervals of a chunked trace instead (see intervals.cpp).          //
+// -shards n splits the sets of the cache among n threads (see shards.cpp).   //
+// -sweep file [-jobs n] runs all configurations of the file over one pass    //
+// of the trace and writes a CSV instead (see sweep.cpp).                     //
+// -mrc sets:assoc writes the LRU misses of every power-of-two set count and  //
+// associativity up to the given ones, from one pass (see stackdist.cpp).     //
+// -sample fraction simulates only that fraction of the sets and reports      //
+// the whole-cache estimate with its confidence interval.                     //
+// -LLCrepl takes the number or the name of a policy of the registry in       //
+// replacement_state.h (lru, random, lirsplus, mlru, opt). OPT runs after a   //
+// next-use pass (see nextuse.h).                                             //
+// -hugepages 1 backs the cache state with transparent huge pages.            //
+// -compact 1 keeps the compact line state, for very large caches; when its   //
+// tags are 32 bits wide, a pass over the trace first checks that all         //
+// addresses are at most CRC_CACHE::ADDRESS_BITS bits wide.                   //
+// -telemetry prefix [-telemetryinterval n] writes the hits, misses and       //
+// evictions of every set and the misses of every n accesses per group of     //
+// sets to prefix.sets.csv, prefix.intervals.csv and prefix.json.             //
+// -threec 1 splits the misses into compulsory, capacity and conflict ones.   //
+// -pcprofile file.csv [-pcprofiletop n] writes the n PCs with the most load  //
+// misses, with their dead evictions and reuse intervals (see pcprof.h).      //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <chrono>
+#include "driver.h"
+#include "pipeline.h"
+#include "nextuse.h"
+
+static const size_t BATCH = 1 << 14;
+
+static void usage(const char* prog) {
+	fprintf(stderr, "usage: %s -t trace [-o stats] [-threads n] [-cache UL3:size:linesize:assoc] [-LLCrepl policy] [-async 0|1]\n"
+			"\t[-intervals n -interval len [-warmup len] [-jobs n]] [-shards n] [-sweep file] [-mrc sets:assoc] [-sample fraction] [-hugepages 0|1]\n"
+			"\t[-policystats file.json] [-compact 0|1] [-telemetry prefix [-telemetryinterval n]] [-threec 0|1]\n"
+			"\t[-pcprofile file.csv [-pcprofiletop n]]\n", prog);
+	exit(1);
+}
+
+static bool parseCache(const char* s, Options& o) {
+	const char* p(strchr(s, ':'));
+	return p && sscanf(p + 1, "%u:%u:%u", &o.size, &o.linesize, &o.assoc) == 3
+		&& o.size && o.linesize && o.assoc;
+}
+
+static void parseArgs(int argc, char** argv, Options& o) {
+	o.threads = 1;
+	o.size = 1024, o.linesize = 64, o.assoc = 16;
+	o.policy = CRC_REPL_LRU;
+	o.async = false;
+	o.trace = o.out = NULL;
+	o.intervals = o.jobs = 0;
+	o.intervalLen = o.warmup = 0;
+	o.shards = 0;
+	o.sweep = NULL;
+	o.mrcSets = o.mrcAssoc = 0;
+	o.sample = 1;
+	o.hugePages = false;
+	o.compact = false;
+	o.policyStats = NULL;
+	o.telemetry = NULL;
+	o.telemetryInterval = 1 << 20;
+	o.threeC = false;
+	o.pcProfile = NULL;
+	o.pcProfileTop = 50;
+	for (int i = 1; i < argc; ++ i) {
+		if (i + 1 == argc) {
+			usage(argv[0]);
+		}
+		if (!strcmp(argv[i], "-t")) {
+			o.trace = argv[++ i];
+		} else if (!strcmp(argv[i], "-o")) {
+			o.out = argv[++ i];
+		} else if (!strcmp(argv[i], "-threads")) {
+			o.threads = atoi(argv[++ i]);
+		} else if (!strcmp(argv[i], "-cache")) {
+			if (!parseCache(argv[++ i], o)) {
+				fprintf(stderr, "bad cache configuration %s\n", argv[i]);
+				exit(1);
+			}
+		} else if (!strcmp(argv[i], "-LLCrepl")) {
+			const CRC_POLICY_OPS* p(CRC_FindPolicy(argv[++ i]));
+			if (p == NULL) {
+				fprintf(stderr, "unknown replacement policy %s\n", argv[i]);
+				exit(1);
+			}
+			o.policy = p->id;
+		} else if (!strcmp(argv[i], "-async")) {
+			o.async = atoi(argv[++ i]);
+		} else if (!strcmp(argv[i], "-intervals")) {
+			o.intervals = atoi(argv[++ i]);
+		} else if (!strcmp(argv[i], "-interval")) {
+			o.intervalLen = strtoull(argv[++ i], NULL, 0);
+		} else if (!strcmp(argv[i], "-warmup")) {
+			o.warmup = strtoull(argv[++ i], NULL, 0);
+		} else if (!strcmp(argv[i], "-jobs")) {
+			o.jobs = atoi(argv[++ i]);
+		} else if (!strcmp(argv[i], "-shards")) {
+			o.shards = atoi(argv[++ i]);
+		} else if (!strcmp(argv[i], "-sweep")) {
+			o.sweep = argv[++ i];
+		} else if (!strcmp(argv[i], "-mrc")) {
+			if (sscanf(argv[++ i], "%u:%u", &o.mrcSets, &o.mrcAssoc) != 2 || !o.mrcSets || !o.mrcAssoc
+					|| (o.mrcSets & (o.mrcSets - 1))) {
+				fprintf(stderr, "bad miss ratio curve range %s, expected power-of-two sets:assoc\n", argv[i]);
+				exit(1);
+			}
+		} else if (!strcmp(argv[i], "-hugepages")) {
+			o.hugePages = atoi(argv[++ i]);
+		} else if (!strcmp(argv[i], "-policystats")) {
+			o.policyStats = argv[++ i];
+		} else if (!strcmp(argv[i], "-compact")) {
+			o.compact = atoi(argv[++ i]);
+		} else if (!strcmp(argv[i], "-telemetry")) {
+			o.telemetry = argv[++ i];
+		} else if (!strcmp(argv[i], "-telemetryinterval")) {
+			o.telemetryInterval = strtoull(argv[++ i], NULL, 0);
+			if (o.telemetryInterval == 0 || o.telemetryInterval > 0xffffffffull) {
+				fprintf(stderr, "bad telemetry interval %s\n", argv[i]);
+				exit(1);
+			}
+		} else if (!strcmp(argv[i], "-pcprofile")) {
+			o.pcProfile = argv[++ i];
+		} else if (!strcmp(argv[i], "-pcprofiletop")) {
+			o.pcProfileTop = atoi(argv[++ i]);
+		} else if (!strcmp(argv[i], "-threec")) {
+			o.threeC = atoi(argv[++ i]);
+		} else if (!strcmp(argv[i], "-sample")) {
+			o.sample = atof(argv[++ i]);
+			if (!(o.sample > 0 && o.sample <= 1)) {
+				fprintf(stderr, "bad sampling fraction %s\n", argv[i]);
+				exit(1);
+			}
+		} else {
+			usage(argv[0]);
+		}
+	}
+	if (o.trace == NULL || o.threads == 0) {
+		usage(argv[0]);
+	}
+	if (o.threads > CRC_CACHE::MAX_THREADS) {
+		fprintf(stderr, "-threads %u exceeds the %u threads of the sharing directories\n", o.threads, CRC_CACHE::MAX_THREADS);
+		exit(1);
+	}
+	if (o.sample < 1 && (o.shards || o.mrcSets)) {
+		fprintf(stderr, "-sample does not combine with -shards or -mrc\n");
+		exit(1);
+	}
+	if (o.policy == CRC_REPL_OPT && (o.intervals || o.shards)) {
+		fprintf(stderr, "OPT replacement needs a full serial run\n");
+		exit(1);
+	}
+	if (o.telemetry && (o.intervals || o.shards || o.sweep || o.mrcSets)) {
+		fprintf(stderr, "-telemetry needs a full serial run\n");
+		exit(1);
+	}
+	if (o.threeC && (o.intervals || o.shards || o.sweep || o.mrcSets || o.sample < 1)) {
+		fprintf(stderr, "-threec needs a full serial run of all sets\n");
+		exit(1);
+	}
+	if (o.pcProfile && (o.intervals || o.shards || o.sweep || o.mrcSets)) {
+		fprintf(stderr, "-pcprofile needs a full serial run\n");
+		exit(1);
+	}
+}
+
+CRC_CACHE* newCache(const Options& o) {
+	CRC_CACHE* cache(CRC_NewCache(o.size << 10, o.assoc, o.threads, o.linesize, o.policy, o.hugePages, true, 0, o.compact));
+	if (o.sample < 1) {
+		cache->SetSampling(o.sample);
+	}
+	return cache;
+}
+
+void validate(const Access* a, size_t n, const Options& o, const TraceReader* tr, COUNTER done) {
+	for (size_t i = 0; i < n; ++ i) {
+		if (a[i].tid >= o.threads || a[i].type >= ACCESS_MAX) {
+			fprintf(stderr, "%s: access %llu has thread %u type %u out of range\n", tr->name(), done + i, a[i].tid, a[i].type);
+			exit(1);
+		}
+	}
+}
+
+bool checkAddresses(const Options& o, COUNTER from, COUNTER len) {
+	TraceReader* tr(openTrace(o.trace));
+	if (tr == NULL) {
+		return false;
+	}
+	if (from && !tr->seek(from)) {
+		fprintf(stderr, "%s: cannot seek to access %llu\n", o.trace, from);
+		delete tr;
+		return false;
+	}
+	Access* buf(new Access[BATCH]);
+	bool ok(true);
+	for (COUNTER done(0); ok && done < len; ) {
+		size_t n(tr->read(buf, std::min((COUNTER)BATCH, len - done)));
+		if (n == 0) {
+			break;
+		}
+		for (size_t i = 0; i < n; ++ i) {
+			if (buf[i].paddr >> CRC_CACHE::ADDRESS_BITS) {
+				fprintf(stderr, "%s: access %llu has address %llx wider than the %u bits the 32-bit tags of -compact 1 hold\n",
+						o.trace, from + done + i, buf[i].paddr, CRC_CACHE::ADDRESS_BITS);
+				ok = false;
+				break;
+			}
+		}
+		done += n;
+	}
+	delete [] buf;
+	delete tr;
+	return ok;
+}
+
+void simulate(CRC_CACHE* cache, const Access* a, size_t n, const Options& o, const TraceReader* tr, COUNTER done,
+		const COUNTER* next) {
+	validate(a, n, o, tr, done);
+	if (next) {
+		for (size_t i = 0; i < n; ++ i) {
+			cache->SetNextUse(next[i]);
+			cache->LookupAndFillCache(a[i].tid, a[i].pc, a[i].paddr, a[i].type);
+		}
+		return;
+	}
+	cache->LookupAndFillBatch(a, n, NULL);
+}
+
+void printDriverStats(ostream& out, COUNTER total, double secs) {
+	out<<endl;
+	out<<"Driver Statistics: "<<endl;
+	out<<"\tAccesses:       "<<total<<endl;
+	out<<"\tSeconds:        "<<secs<<endl;
+	out<<"\tAccesses/sec:   "<<(COUNTER)(secs > 0 ? total / secs : 0)<<endl;
+	fprintf(stderr, "%llu accesses in %.2fs, %.0f accesses/sec\n", total, secs, secs > 0 ? total / secs : 0);
+}
+
+void writePolicyStats(CRC_CACHE* cache, const Options& o) {
+	if (o.policyStats == NULL) {
+		return;
+	}
+	std::ofstream f(o.policyStats);
+	if (!f) {
+		fprintf(stderr, "cannot write %s\n", o.policyStats);
+		return;
+	}
+	cache->PrintPolicyStatsJSON(f);
+}
+
+void writeTelemetry(CRC_CACHE* cache, const Options& o) {
+	if (o.telemetry == NULL) {
+		return;
+	}
+	std::string prefix(o.telemetry);
+	std::ofstream sets((prefix + ".sets.csv").c_str());
+	std::ofstream intervals((prefix + ".intervals.csv").c_str());
+	std::ofstream json((prefix + ".json").c_str());
+	if (!sets || !intervals || !json) {
+		fprintf(stderr, "cannot write %s.*\n", o.telemetry);
+		return;
+	}
+	cache->Telemetry()->WriteSetsCSV(sets);
+	cache->Telemetry()->WriteIntervalsCSV(intervals);
+	cache->Telemetry()->WriteJSON(json);
+}
+
+void writePCProfile(CRC_CACHE* cache, const Options& o) {
+	if (o.pcProfile == NULL) {
+		return;
+	}
+	std::ofstream f(o.pcProfile);
+	if (!f) {
+		fprintf(stderr, "cannot write %s\n", o.pcProfile);
+		return;
+	}
+	cache->PCProfile()->WriteCSV(f, o.pcProfileTop);
+	if (cache->PCProfile()->Replaced()) {
+		fprintf(stderr, "%llu PC profile entries were taken over by other PCs\n", cache->PCProfile()->Replaced());
+	}
+}
+
+int main(int argc, char** argv) {
+	Options o;
+	parseArgs(argc, argv, o);
+
+	std::ofstream fout;
+	if (o.out) {
+		fout.open(o.out);
+		if (!fout) {
+			perror(o.out);
+			return 1;
+		}
+	}
+	ostream& out(o.out ? fout : cout);
+
+	if (o.intervals) {
+		return runIntervals(o, out);
+	}
+	if (o.shards) {
+		return runShards(o, out);
+	}
+	if (o.sweep) {
+		return runSweep(o, out);
+	}
+	if (o.mrcSets) {
+		return runMrc(o, out);
+	}
+
+	TraceReader* tr(openTrace(o.trace));
+	if (tr == NULL) {
+		return 1;
+	}
+	NextUseColumn* nextUse(NULL);
+	if (o.policy == CRC_REPL_OPT) {
+		std::chrono::steady_clock::time_point start(std::chrono::steady_clock::now());
+		nextUse = new NextUseColumn;
+		if (!nextUse->build(tr, CRC_FloorLog2(o.linesize))) {
+			return 1;
+		}
+		delete tr;
+		if ((tr = openTrace(o.trace)) == NULL) {
+			return 1;
+		}
+		fprintf(stderr, "next-use pass over %llu accesses in %.2fs\n", nextUse->count(),
+				std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+	}
+	CRC_CACHE* cache(newCache(o));
+	cache->PrintMemory(cerr);
+	if (cache->Tags32() && !checkAddresses(o)) {
+		return 1;
+	}
+	if (o.telemetry) {
+		cache->EnableTelemetry(o.telemetryInterval);
+	}
+	if (o.threeC) {
+		cache->EnableMissClassification();
+	}
+	if (o.pcProfile) {
+		cache->EnablePCProfile();
+	}
+
+	Access* buf(new Access[BATCH]);
+	COUNTER* next(nextUse ? new COUNTER[BATCH] : NULL);
+	AsyncTraceReader* async(o.async ? new AsyncTraceReader(tr) : NULL);
+	COUNTER total(0);
+	std::chrono::steady_clock::time_point start(std::chrono::steady_clock::now());
+	if (async) {
+		tr = async;
+		const Access* b;
+		for (size_t n; (b = async->acquire(n)) != NULL; total += n) {
+			if (nextUse) {
+				nextUse->read(next, n);
+			}
+			simulate(cache, b, n, o, tr, total, next);
+			async->release();
+		}
+	} else {
+		for (size_t n; (n = tr->read(buf, BATCH)) > 0; total += n) {
+			if (nextUse) {
+				nextUse->read(next, n);
+			}
+			simulate(cache, buf, n, o, tr, total, next);
+		}
+	}
+	double secs(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+
+	cache->PrintStats(out);
+	printDriverStats(out, total, secs);
+	writePolicyStats(cache, o);
+	writeTelemetry(cache, o);
+	writePCProfile(cache, o);
+	if (async) {
+		out<<"\tDecode stall:   "<<async->decodeStall()<<"s"<<endl;
+		out<<"\tSimulate stall: "<<async->simulateStall()<<"s"<<endl;
+	}
+
+	delete [] buf;
+	delete [] next;
+	delete nextUse;
+	delete cache;
+	delete tr;
+	return 0;
+}
@@ -0,0 +1,74 @@
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Converts a trace into the compact columnar format (see ctrace.h)           //
+//                                                                            //
+//   ctconv [-line shift] [-chunk accesses] input output                      //
+//                                                                            //
+// The output is the plain flavour, replayed from an mmap'ed image with its   //
+// columns bit-packed. -chunk n writes the chunked flavour instead, deflated  //
+// chunks of n accesses that a run can seek into, e.g. 65536 for -intervals.  //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "ctrace.h"
+#include "crc_cache_defs.h"
+
+static const size_t BATCH = 1 << 14;
+
+int main(int argc, char** argv) {
+	UINT32 lineShift(6), chunk(0);
+	int i(1);
+	for (; i + 2 < argc && argv[i][0] == '-'; i += 2) {
+		if (!strcmp(argv[i], "-line")) {
+			lineShift = atoi(argv[i + 1]);
+		} else if (!strcmp(argv[i], "-chunk")) {
+			chunk = atoi(argv[i + 1]);
+		} else {
+			break;
+		}
+	}
+	if (i + 2 != argc || lineShift > 32) {
+		fprintf(stderr, "usage: %s [-line shift] [-chunk accesses] input output\n", argv[0]);
+		return 1;
+	}
+	const char *in(argv[i]), *outPath(argv[i + 1]);
+
+	TraceReader* tr(openTrace(in));
+	if (tr == NULL) {
+		return 1;
+	}
+	CtTraceWriter* ct(chunk ? NULL : new CtTraceWriter(outPath, lineShift));
+	CzTraceWriter* cz(chunk ? new CzTraceWriter(outPath, chunk, lineShift) : NULL);
+	if (ct ? !ct->good() : !cz->good()) {
+		return 1;
+	}
+	Access* buf(new Access[BATCH]);
+	COUNTER total(0);
+	bool ok(true);
+	for (size_t n; ok && (n = tr->read(buf, BATCH)) > 0; total += n) {
+		for (size_t i = 0; i < n; ++ i) {
+			if (buf[i].tid > 0xff || buf[i].type >= ACCESS_MAX) {
+				fprintf(stderr, "%s: access %llu has thread %u type %u out of range\n", tr->name(), total + i, buf[i].tid, buf[i].type);
+				return 1;
+			}
+		}
+		if (ct) {
+			ct->write(buf, n);
+		} else {
+			ok = cz->write(buf, n);
+		}
+	}
+	if (!ok || !(ct ? ct->close() : cz->close())) {
+		perror(outPath);
+		return 1;
+	}
+	fprintf(stderr, "%llu accesses written to %s\n", total, outPath);
+	delete [] buf;
+	delete ct;
+	delete cz;
+	delete tr;
+	return 0;
+}
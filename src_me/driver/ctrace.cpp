@@ -0,0 +1,448 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "ctrace.h"
+
+CtTraceReader::CtTraceReader(const char* _path) {
+	path = _path;
+	base = NULL;
+	done = 0;
+	int fd(open(_path, O_RDONLY));
+	if (fd < 0) {
+		perror(_path);
+		return;
+	}
+	struct stat st;
+	if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(CtHeader)) {
+		size = st.st_size;
+		void* p(mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0));
+		if (p != MAP_FAILED) {
+			base = (unsigned char*)p;
+			madvise(base, size, MADV_SEQUENTIAL);
+		}
+	}
+	close(fd);
+	if (base == NULL) {
+		fprintf(stderr, "%s: cannot map trace\n", _path);
+		return;
+	}
+	hdr = (const CtHeader*)base;
+	version = !memcmp(hdr->magic, CT_MAGIC, sizeof(hdr->magic)) ? 3 : !memcmp(hdr->magic, CT_MAGIC_V2, sizeof(hdr->magic)) ? 2
+		: !memcmp(hdr->magic, CT_MAGIC_V1, sizeof(hdr->magic)) ? 1 : 0;
+	bool ok(version != 0);
+	for (int c = 0; ok && c < CT_COLUMNS; ++ c) {
+		ok = hdr->off[c] <= size && hdr->len[c] <= size - hdr->off[c];
+	}
+	// The dictionary is read in place, the v1 TID and TYPE by index
+	ok = ok && hdr->npc <= size / sizeof(Addr_t) && hdr->len[CT_PCDICT] == hdr->npc * sizeof(Addr_t)
+		&& hdr->off[CT_PCDICT] % sizeof(Addr_t) == 0;
+	ok = ok && (version != 1 || (hdr->len[CT_TID] >= hdr->count && hdr->len[CT_TYPE] >= hdr->count)) && hdr->lineShift <= 32;
+	if (!ok) {
+		fprintf(stderr, "%s: not a columnar trace or truncated\n", _path);
+		munmap(base, size);
+		base = NULL;
+		return;
+	}
+	pcs = (const Addr_t*)(base + hdr->off[CT_PCDICT]);
+	pc = base + hdr->off[CT_PC];
+	line = base + hdr->off[CT_LINE];
+	offset = base + hdr->off[CT_OFFSET];
+	tid = base + hdr->off[CT_TID];
+	type = base + hdr->off[CT_TYPE];
+	pcEnd = pc + hdr->len[CT_PC];
+	lineEnd = line + hdr->len[CT_LINE];
+	offsetEnd = offset + hdr->len[CT_OFFSET];
+	pcRuns.init(pc, pcEnd);
+	tidRuns.init(tid, tid + hdr->len[CT_TID]);
+	typeRuns.init(type, type + hdr->len[CT_TYPE]);
+	pcPack.init(pc, pcEnd);
+	linePack.init(line, lineEnd);
+	offsetPack.init(offset, offsetEnd);
+	tidPack.init(tid, tid + hdr->len[CT_TID]);
+	prevLine.assign(hdr->npc, 0);
+}
+
+CtTraceReader::~CtTraceReader() {
+	if (base) {
+		munmap(base, size);
+	}
+}
+
+size_t CtTraceReader::read(Access* a, size_t n) {
+	if (n > hdr->count - done) {
+		n = hdr->count - done;
+	}
+	UINT32 shift(hdr->lineShift);
+	if (version == 3) {
+		for (size_t i = 0; i < n; ++ i) {
+			COUNTER k, v, o, t;
+			if (!pcPack.get(k) || k >= hdr->npc || !linePack.get(v) || !offsetPack.get(o) || !tidPack.get(t)) {
+				corrupt(done + i);
+			}
+			a[i].pc = pcs[k];
+			a[i].paddr = ((prevLine[k] += unzigzag(v)) << shift) | o;
+			a[i].tid = t >> CT_TYPE_BITS;
+			a[i].type = t & ((1 << CT_TYPE_BITS) - 1);
+		}
+		done += n;
+		return n;
+	}
+	if (version == 1) {
+		for (size_t i = 0; i < n; ++ i) {
+			COUNTER k, l, v, o;
+			if ((pc = getVarint(pc, pcEnd, k)) == NULL || k >= hdr->npc
+					|| (line = getVarint(line, lineEnd, v)) == NULL || (offset = getVarint(offset, offsetEnd, o)) == NULL) {
+				corrupt(done + i);
+			}
+			a[i].pc = pcs[k];
+			l = prevLine[k] += unzigzag(v);
+			a[i].paddr = (l << shift) | o;
+			a[i].tid = tid[done + i];
+			a[i].type = type[done + i];
+		}
+		done += n;
+		return n;
+	}
+	bool offsets(hdr->len[CT_OFFSET] != 0);
+	for (size_t i = 0; i < n; ++ i) {
+		COUNTER k, l, v, o(0), t, y;
+		if (!pcRuns.get(k) || k >= hdr->npc || (line = getVarint(line, lineEnd, v)) == NULL
+				|| (offsets && (offset = getVarint(offset, offsetEnd, o)) == NULL) || !tidRuns.get(t) || !typeRuns.get(y)) {
+			corrupt(done + i);
+		}
+		a[i].pc = pcs[k];
+		l = prevLine[k] += unzigzag(v);
+		a[i].paddr = (l << shift) | o;
+		a[i].tid = t;
+		a[i].type = y;
+	}
+	done += n;
+	return n;
+}
+
+// A column ran out or held an index out of range; the rest of the file
+// cannot be trusted
+void CtTraceReader::corrupt(COUNTER i) const {
+	fprintf(stderr, "%s: access %llu is corrupt\n", name(), i);
+	exit(1);
+}
+
+CtTraceWriter::CtTraceWriter(const char* path, UINT32 lineShift) {
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.magic, CT_MAGIC, sizeof(hdr.magic));
+	hdr.lineShift = lineShift;
+	for (int c = 0; c < CT_COLUMNS; ++ c) {
+		col[c] = NULL;
+	}
+	if ((out = fopen(path, "wb")) == NULL) {
+		perror(path);
+		return;
+	}
+	for (int c = CT_PC; c < CT_COLUMNS; ++ c) {
+		if ((col[c] = tmpfile()) == NULL) {
+			perror("tmpfile");
+			fclose(out);
+			out = NULL;
+			return;
+		}
+	}
+}
+
+CtTraceWriter::~CtTraceWriter() {
+	for (int c = 0; c < CT_COLUMNS; ++ c) {
+		if (col[c]) {
+			fclose(col[c]);
+		}
+	}
+	if (out) {
+		fclose(out);
+	}
+}
+
+void CtTraceWriter::spill(int c) {
+	fwrite(buf[c].data(), 1, buf[c].size(), col[c]);
+	hdr.len[c] += buf[c].size();
+	buf[c].clear();
+}
+
+void CtTraceWriter::write(const Access* a, size_t n) {
+	for (size_t i = 0; i < n; ++ i) {
+		std::unordered_map<Addr_t, COUNTER>::iterator it(dict.find(a[i].pc));
+		if (it == dict.end()) {
+			it = dict.insert(std::make_pair(a[i].pc, (COUNTER)pcs.size())).first;
+			pcs.push_back(a[i].pc);
+			prevLine.push_back(0);
+		}
+		packs[CT_PC].put(buf[CT_PC], it->second);
+
+		COUNTER l(a[i].paddr >> hdr.lineShift);
+		packs[CT_LINE].put(buf[CT_LINE], zigzag(l - prevLine[it->second]));
+		prevLine[it->second] = l;
+		packs[CT_OFFSET].put(buf[CT_OFFSET], a[i].paddr & ((1ull << hdr.lineShift) - 1));
+
+		packs[CT_TID].put(buf[CT_TID], (COUNTER)a[i].tid << CT_TYPE_BITS | a[i].type);
+	}
+	hdr.count += n;
+	for (int c = CT_PC; c < CT_COLUMNS; ++ c) {
+		if (buf[c].size() >= SPILL) {
+			spill(c);
+		}
+	}
+}
+
+// Lays the columns out behind the header, each one 8 byte aligned
+bool CtTraceWriter::close() {
+	static const char pad[8] = { 0 };
+	std::vector<unsigned char> copy(SPILL);
+	hdr.npc = pcs.size();
+	hdr.len[CT_PCDICT] = pcs.size() * sizeof(Addr_t);
+	COUNTER pos(sizeof(hdr));
+	bool ok(fwrite(&hdr, sizeof(hdr), 1, out) == 1);
+	for (int c = 0; ok && c < CT_COLUMNS; ++ c) {
+		if (c != CT_PCDICT) {
+			packs[c].flush(buf[c]);
+			spill(c);
+			rewind(col[c]);
+		}
+		ok = fwrite(pad, 1, (8 - pos % 8) % 8, out) == (8 - pos % 8) % 8;
+		pos = hdr.off[c] = (pos + 7) & ~7ull;
+		if (c == CT_PCDICT) {
+			ok = ok && fwrite(pcs.data(), sizeof(Addr_t), pcs.size(), out) == pcs.size();
+		} else {
+			for (size_t r; ok && (r = fread(copy.data(), 1, copy.size(), col[c])) > 0; ) {
+				ok = fwrite(copy.data(), 1, r, out) == r;
+			}
+		}
+		pos += hdr.len[c];
+	}
+	ok = ok && fseek(out, 0, SEEK_SET) == 0 && fwrite(&hdr, sizeof(hdr), 1, out) == 1;
+	ok = (fclose(out) == 0) && ok;
+	out = NULL;
+	return ok;
+}
+
+CzTraceReader::CzTraceReader(const char* _path) {
+	path = _path;
+	chunk = ~0ull;
+	pos = 0;
+	if ((fd = open(_path, O_RDONLY)) < 0) {
+		perror(_path);
+		return;
+	}
+	struct stat st;
+	bool ok(pread(fd, &hdr, sizeof(hdr), 0) == sizeof(hdr) && !memcmp(hdr.magic, CZ_MAGIC, sizeof(hdr.magic)) && fstat(fd, &st) == 0);
+	// Nothing is allocated that the file cannot hold
+	ok = ok && hdr.lineShift <= 32 && hdr.chunk > 0 && hdr.nchunks == (hdr.count + hdr.chunk - 1) / hdr.chunk
+		&& hdr.npc <= (COUNTER)st.st_size / sizeof(Addr_t) && hdr.nchunks <= (COUNTER)st.st_size / sizeof(CzIndex);
+	if (ok) {
+		pcs.resize(hdr.npc);
+		index.resize(hdr.nchunks);
+		ok = pread(fd, pcs.data(), hdr.npc * sizeof(Addr_t), hdr.dictOff) == (ssize_t)(hdr.npc * sizeof(Addr_t))
+			&& pread(fd, index.data(), hdr.nchunks * sizeof(CzIndex), hdr.indexOff) == (ssize_t)(hdr.nchunks * sizeof(CzIndex));
+	}
+	if (!ok) {
+		fprintf(stderr, "%s: not a chunked trace or truncated\n", _path);
+		close(fd);
+		fd = -1;
+	}
+}
+
+CzTraceReader::~CzTraceReader() {
+	if (fd >= 0) {
+		close(fd);
+	}
+}
+
+// Inflates chunk c and decodes all of its columns
+bool CzTraceReader::load(COUNTER c) {
+	const CzIndex& e(index[c]);
+	size_t n(std::min((COUNTER)hdr.chunk, hdr.count - c * hdr.chunk));
+	// At most three 10 byte varints and two bytes per access
+	bool ok(e.len >= sizeof(UINT32) * CT_COLUMNS && e.len <= sizeof(UINT32) * CT_COLUMNS + 32 * n
+			&& e.zlen <= compressBound(e.len));
+	if (ok) {
+		zbuf.resize(e.zlen);
+		raw.resize(e.len);
+		uLongf len(e.len);
+		ok = pread(fd, zbuf.data(), e.zlen, e.off) == (ssize_t)e.zlen
+			&& uncompress(raw.data(), &len, zbuf.data(), e.zlen) == Z_OK && len == e.len && decode(n);
+	}
+	if (!ok) {
+		fprintf(stderr, "%s: chunk %llu is corrupt\n", name(), c);
+		return false;
+	}
+	chunk = c;
+	pos = 0;
+	return true;
+}
+
+// Decodes the n accesses of the inflated chunk in raw, false if a column
+// runs past its length or the lengths past the chunk
+bool CzTraceReader::decode(size_t n) {
+	const UINT32* clen((const UINT32*)raw.data());
+	const unsigned char *col[CT_COLUMNS], *end[CT_COLUMNS];
+	COUNTER left(raw.size() - sizeof(UINT32) * CT_COLUMNS);
+	col[CT_PC] = raw.data() + sizeof(UINT32) * CT_COLUMNS;
+	for (int k = CT_PC; k < CT_COLUMNS; ++ k) {
+		if (clen[k] > left) {
+			return false;
+		}
+		left -= clen[k];
+		end[k] = col[k] + clen[k];
+		if (k + 1 < CT_COLUMNS) {
+			col[k + 1] = end[k];
+		}
+	}
+	if (left != 0 || clen[CT_TID] < n || clen[CT_TYPE] < n) {
+		return false;
+	}
+	std::vector<COUNTER> prevLine(hdr.npc, 0);
+	cur.resize(n);
+	for (size_t i = 0; i < n; ++ i) {
+		COUNTER k, l, v, o;
+		if ((col[CT_PC] = getVarint(col[CT_PC], end[CT_PC], k)) == NULL || k >= hdr.npc
+				|| (col[CT_LINE] = getVarint(col[CT_LINE], end[CT_LINE], v)) == NULL
+				|| (col[CT_OFFSET] = getVarint(col[CT_OFFSET], end[CT_OFFSET], o)) == NULL) {
+			return false;
+		}
+		cur[i].pc = pcs[k];
+		l = prevLine[k] += unzigzag(v);
+		cur[i].paddr = (l << hdr.lineShift) | o;
+		cur[i].tid = col[CT_TID][i];
+		cur[i].type = col[CT_TYPE][i];
+	}
+	return true;
+}
+
+bool CzTraceReader::seek(COUNTER a) {
+	if (a > hdr.count) {
+		return false;
+	}
+	if (a == hdr.count) {
+		chunk = hdr.nchunks;
+		cur.clear();
+		pos = 0;
+		return true;
+	}
+	if (a / hdr.chunk != chunk && !load(a / hdr.chunk)) {
+		return false;
+	}
+	pos = a % hdr.chunk;
+	return true;
+}
+
+size_t CzTraceReader::read(Access* a, size_t n) {
+	size_t k(0);
+	while (k < n) {
+		if (chunk == ~0ull || pos == cur.size()) {
+			COUNTER next(chunk == ~0ull ? 0 : chunk + 1);
+			if (next >= hdr.nchunks || !load(next)) {
+				break;
+			}
+		}
+		size_t c(std::min(n - k, cur.size() - pos));
+		memcpy(a + k, cur.data() + pos, c * sizeof(Access));
+		k += c;
+		pos += c;
+	}
+	return k;
+}
+
+CzTraceWriter::CzTraceWriter(const char* path, UINT32 chunk, UINT32 lineShift) {
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.magic, CZ_MAGIC, sizeof(hdr.magic));
+	hdr.lineShift = lineShift;
+	hdr.chunk = chunk;
+	if ((out = fopen(path, "wb")) == NULL) {
+		perror(path);
+		return;
+	}
+	// The header is rewritten once the index is known
+	if (fwrite(&hdr, sizeof(hdr), 1, out) != 1) {
+		fclose(out);
+		out = NULL;
+	}
+}
+
+CzTraceWriter::~CzTraceWriter() {
+	if (out) {
+		fclose(out);
+	}
+}
+
+bool CzTraceWriter::write(const Access* a, size_t n) {
+	while (n > 0) {
+		size_t c(std::min(n, hdr.chunk - pending.size()));
+		pending.insert(pending.end(), a, a + c);
+		a += c, n -= c;
+		if (pending.size() == hdr.chunk && !flush()) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool CzTraceWriter::flush() {
+	if (pending.empty()) {
+		return true;
+	}
+	std::vector<unsigned char> col[CT_COLUMNS];
+	std::vector<COUNTER> prevLine(pcs.size(), 0);
+	unsigned char tmp[10];
+	for (size_t i = 0; i < pending.size(); ++ i) {
+		const Access& e(pending[i]);
+		std::unordered_map<Addr_t, COUNTER>::iterator it(dict.find(e.pc));
+		if (it == dict.end()) {
+			it = dict.insert(std::make_pair(e.pc, (COUNTER)pcs.size())).first;
+			pcs.push_back(e.pc);
+			prevLine.push_back(0);
+		}
+		col[CT_PC].insert(col[CT_PC].end(), tmp, putVarint(tmp, it->second));
+		COUNTER l(e.paddr >> hdr.lineShift);
+		col[CT_LINE].insert(col[CT_LINE].end(), tmp, putVarint(tmp, zigzag(l - prevLine[it->second])));
+		prevLine[it->second] = l;
+		col[CT_OFFSET].insert(col[CT_OFFSET].end(), tmp,
+				putVarint(tmp, e.paddr & ((1ull << hdr.lineShift) - 1)));
+		col[CT_TID].push_back(e.tid);
+		col[CT_TYPE].push_back(e.type);
+	}
+	raw.assign(sizeof(UINT32) * CT_COLUMNS, 0);
+	for (int k = CT_PC; k < CT_COLUMNS; ++ k) {
+		((UINT32*)raw.data())[k] = col[k].size();
+	}
+	for (int k = CT_PC; k < CT_COLUMNS; ++ k) {
+		raw.insert(raw.end(), col[k].begin(), col[k].end());
+	}
+	uLongf zlen(compressBound(raw.size()));
+	zbuf.resize(zlen);
+	if (compress2(zbuf.data(), &zlen, raw.data(), raw.size(), 6) != Z_OK) {
+		return false;
+	}
+	CzIndex e;
+	e.off = ftello(out);
+	e.zlen = zlen;
+	e.len = raw.size();
+	index.push_back(e);
+	hdr.count += pending.size();
+	pending.clear();
+	return fwrite(zbuf.data(), 1, zlen, out) == zlen;
+}
+
+bool CzTraceWriter::close() {
+	bool ok(flush());
+	hdr.npc = pcs.size();
+	hdr.nchunks = index.size();
+	hdr.dictOff = ftello(out);
+	ok = ok && fwrite(pcs.data(), sizeof(Addr_t), pcs.size(), out) == pcs.size();
+	hdr.indexOff = ftello(out);
+	ok = ok && fwrite(index.data(), sizeof(CzIndex), index.size(), out) == index.size();
+	ok = ok && fseek(out, 0, SEEK_SET) == 0 && fwrite(&hdr, sizeof(hdr), 1, out) == 1;
+	ok = (fclose(out) == 0) && ok;
+	out = NULL;
+	return ok;
+}
@@ -0,0 +1,358 @@
+#ifndef CTRACE_H
+#define CTRACE_H
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Compact columnar trace format. Every field of an access lives in its own   //
+// column right behind the header:                                            //
+//                                                                            //
+//   PCDICT  distinct PCs, raw 64 bit                                         //
+//   PC      index into PCDICT per access, packed                             //
+//   LINE    (paddr >> lineShift) minus the previous line of the same PC,     //
+//           zigzagged and packed                                             //
+//   OFFSET  paddr bits below lineShift, packed                               //
+//   TID     tid << CT_TYPE_BITS | access type per access, packed             //
+//   TYPE    empty                                                            //
+//                                                                            //
+// A packed column is a frame per 64 values: a byte w and a byte e, the low   //
+// w bits of every value in w little-endian 64 bit words, then e exceptions,  //
+// the byte index of a value and varint(its bits above w). The writer picks   //
+// the w that makes the frame smallest, so a few far jumps do not widen all   //
+// values. A PC index takes at most ceil(log2 npc) bits, tid and type a byte  //
+// for up to 32 threads, and a stride of the same PC or a zero offset a few   //
+// bits or none. The file is replayed straight out of an mmap'ed image.       //
+//                                                                            //
+// Files of the second version, with run-length coded PC, TID and TYPE        //
+// columns and varint lines and offsets, and of the first, with raw varint    //
+// PCs and offsets and a byte per TID and TYPE, still read.                   //
+//                                                                            //
+// The chunked flavour splits the trace into independently deflated chunks    //
+// of a fixed number of accesses, each holding the PC..TYPE columns of the    //
+// first version with the LINE deltas restarted, followed by the shared       //
+// PCDICT and a chunk index. Any access can be reached by inflating a single  //
+// chunk.                                                                     //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+#include <cstring>
+#include <vector>
+#include <unordered_map>
+#include "trace.h"
+
+#define CT_MAGIC "CRCTRC3"
+#define CT_MAGIC_V2 "CRCTRC2"
+#define CT_MAGIC_V1 "CRCTRC1"
+
+// Access types below ACCESS_MAX fit in the low bits of the TID column
+#define CT_TYPE_BITS 3
+#define CZ_MAGIC "CRCTRZ1"
+
+enum {
+	CT_PCDICT = 0,
+	CT_PC,
+	CT_LINE,
+	CT_OFFSET,
+	CT_TID,
+	CT_TYPE,
+	CT_COLUMNS
+};
+
+struct CtHeader {
+	char magic[8];
+	UINT32 lineShift, reserved;
+	COUNTER count, npc;
+	COUNTER off[CT_COLUMNS], len[CT_COLUMNS];
+};
+
+struct CzHeader {
+	char magic[8];
+	UINT32 lineShift, chunk;
+	COUNTER count, npc, nchunks;
+	COUNTER dictOff, indexOff;
+};
+
+struct CzIndex {
+	COUNTER off;
+	UINT32 zlen, len;
+};
+
+static inline unsigned char* putVarint(unsigned char* p, COUNTER v) {
+	for (; v >= 0x80; v >>= 7) {
+		*(p ++) = (v & 0x7f) | 0x80;
+	}
+	*(p ++) = v;
+	return p;
+}
+
+// NULL if the varint runs past end or over 64 bits
+static inline const unsigned char* getVarint(const unsigned char* p, const unsigned char* end, COUNTER& v) {
+	v = 0;
+	for (int s = 0; p < end && s < 64; s += 7) {
+		v |= (COUNTER)(*p & 0x7f) << s;
+		if (!(*(p ++) & 0x80)) {
+			return p;
+		}
+	}
+	return NULL;
+}
+
+static inline COUNTER zigzag(long long v) {
+	return ((COUNTER)v << 1) ^ (COUNTER)(v >> 63);
+}
+
+static inline long long unzigzag(COUNTER v) {
+	return (long long)(v >> 1) ^ -(long long)(v & 1);
+}
+
+// Writes a packed column, the last frame is padded with zeros by flush
+class CtPackWriter {
+	public:
+		static const UINT32 FRAME = 64;
+
+		CtPackWriter() : n(0) {}
+		void put(std::vector<unsigned char>& out, COUNTER v) {
+			vals[n ++] = v;
+			if (n == FRAME) {
+				flush(out);
+			}
+		}
+		void flush(std::vector<unsigned char>& out) {
+			if (n == 0) {
+				return;
+			}
+			COUNTER all(0), words[FRAME];
+			for (; n < FRAME; ++ n) {
+				vals[n] = 0;
+			}
+			for (UINT32 i = 0; i < FRAME; ++ i) {
+				all |= vals[i];
+				words[i] = 0;
+			}
+			UINT32 w(width());
+			COUNTER mask(w == 64 ? ~0ull : (1ull << w) - 1);
+			for (UINT32 i = 0, bit = 0; w && i < FRAME; ++ i, bit += w) {
+				COUNTER v(vals[i] & mask);
+				words[bit >> 6] |= v << (bit & 63);
+				if ((bit & 63) + w > 64) {
+					words[(bit >> 6) + 1] |= v >> (64 - (bit & 63));
+				}
+			}
+			out.push_back(w);
+			size_t e(out.size());
+			out.push_back(0);
+			out.insert(out.end(), (unsigned char*)words, (unsigned char*)(words + w));
+			for (UINT32 i = 0; w < 64 && i < FRAME; ++ i) {
+				if (vals[i] >> w) {
+					unsigned char tmp[10];
+					++ out[e];
+					out.push_back(i);
+					out.insert(out.end(), tmp, putVarint(tmp, vals[i] >> w));
+				}
+			}
+			n = 0;
+		}
+	private:
+		COUNTER vals[FRAME];
+		UINT32 n;
+		// The width of the smallest frame, from the counts of the values by
+		// their bits
+		UINT32 width() const {
+			UINT32 count[65] = { 0 };
+			for (UINT32 i = 0; i < FRAME; ++ i) {
+				++ count[vals[i] ? 64 - __builtin_clzll(vals[i]) : 0];
+			}
+			UINT32 best(0);
+			COUNTER bestBytes(~0ull);
+			for (UINT32 w = 0; w <= 64; ++ w) {
+				COUNTER bytes(8 * w);
+				for (UINT32 b = w + 1; b <= 64; ++ b) {
+					bytes += count[b] * (1 + (b - w + 6) / 7);
+				}
+				if (bytes < bestBytes) {
+					best = w, bestBytes = bytes;
+				}
+			}
+			return best;
+		}
+};
+
+// Reads a packed column of [p, end) a frame at a time, false once it runs
+// past end
+class CtPackReader {
+	public:
+		void init(const unsigned char* _p, const unsigned char* _end) {
+			p = _p, end = _end, i = CtPackWriter::FRAME;
+		}
+		bool get(COUNTER& v) {
+			if (i == CtPackWriter::FRAME && !frame()) {
+				return false;
+			}
+			v = vals[i ++];
+			return true;
+		}
+	private:
+		const unsigned char *p, *end;
+		COUNTER vals[CtPackWriter::FRAME];
+		UINT32 i;
+		bool frame() {
+			UINT32 w, e;
+			if (end - p < 2 || (w = p[0]) > 64 || (e = p[1]) > CtPackWriter::FRAME || (size_t)(end - p - 2) < 8 * w) {
+				return false;
+			}
+			const unsigned char* q(p + 2);
+			COUNTER mask(w == 64 ? ~0ull : (1ull << w) - 1);
+			for (UINT32 k = 0, bit = 0; k < CtPackWriter::FRAME; ++ k, bit += w) {
+				COUNTER x(0);
+				if (w) {
+					memcpy(&x, q + 8 * (bit >> 6), 8);
+					x >>= bit & 63;
+					if ((bit & 63) + w > 64) {
+						COUNTER y;
+						memcpy(&y, q + 8 * ((bit >> 6) + 1), 8);
+						x |= y << (64 - (bit & 63));
+					}
+				}
+				vals[k] = x & mask;
+			}
+			p = q + 8 * w;
+			for (; e > 0; -- e) {
+				COUNTER high;
+				UINT32 k;
+				if (p == end || (k = *(p ++)) >= CtPackWriter::FRAME || w == 64 || (p = getVarint(p, end, high)) == NULL) {
+					return false;
+				}
+				vals[k] |= high << w;
+			}
+			i = 0;
+			return true;
+		}
+};
+
+// Reads a run column of [p, end), false once it runs past end
+class CtRunReader {
+	public:
+		void init(const unsigned char* _p, const unsigned char* _end) {
+			p = _p, end = _end, left = 0;
+		}
+		bool get(COUNTER& v) {
+			if (left == 0) {
+				COUNTER r;
+				if ((p = getVarint(p, end, r)) == NULL) {
+					return false;
+				}
+				value = r >> 1, left = 1;
+				if (r & 1) {
+					if ((p = getVarint(p, end, r)) == NULL) {
+						return false;
+					}
+					left = r + 2;
+				}
+			}
+			-- left;
+			v = value;
+			return true;
+		}
+	private:
+		const unsigned char *p, *end;
+		COUNTER value, left;
+};
+
+// Replays a columnar trace from its mapped image
+class CtTraceReader : public TraceReader {
+	public:
+		CtTraceReader(const char*);
+		~CtTraceReader();
+		size_t read(Access*, size_t);
+		bool good() const {
+			return base != NULL;
+		}
+		COUNTER count() const {
+			return hdr->count;
+		}
+	private:
+		unsigned char *base;
+		size_t size;
+		const CtHeader* hdr;
+		const Addr_t* pcs;
+		const unsigned char *pc, *line, *offset, *tid, *type;
+		const unsigned char *pcEnd, *lineEnd, *offsetEnd;
+		CtRunReader pcRuns, tidRuns, typeRuns;
+		CtPackReader pcPack, linePack, offsetPack, tidPack;
+		int version;
+		COUNTER done;
+		std::vector<COUNTER> prevLine;
+		void corrupt(COUNTER) const;
+};
+
+// Encodes a trace into the columnar format; columns are spilled to
+// temporary files so that the input may be larger than memory
+class CtTraceWriter {
+	public:
+		CtTraceWriter(const char*, UINT32 lineShift = 6);
+		~CtTraceWriter();
+		bool good() const {
+			return out != NULL;
+		}
+		void write(const Access*, size_t);
+		bool close();
+	private:
+		static const size_t SPILL = 1 << 24;
+
+		FILE *out, *col[CT_COLUMNS];
+		std::vector<unsigned char> buf[CT_COLUMNS];
+		CtHeader hdr;
+		std::vector<Addr_t> pcs;
+		std::unordered_map<Addr_t, COUNTER> dict;
+		std::vector<COUNTER> prevLine;
+		CtPackWriter packs[CT_COLUMNS];
+		void spill(int);
+};
+
+// Random access reader for chunked traces. Only the current chunk is kept
+// in memory, so every reader (e.g. one per interval) is cheap.
+class CzTraceReader : public TraceReader {
+	public:
+		CzTraceReader(const char*);
+		~CzTraceReader();
+		size_t read(Access*, size_t);
+		bool seek(COUNTER);
+		bool good() const {
+			return fd >= 0;
+		}
+		COUNTER count() const {
+			return hdr.count;
+		}
+	private:
+		int fd;
+		CzHeader hdr;
+		std::vector<Addr_t> pcs;
+		std::vector<CzIndex> index;
+		std::vector<unsigned char> zbuf, raw;
+		std::vector<Access> cur;
+		COUNTER chunk;
+		size_t pos;
+		bool load(COUNTER);
+		bool decode(size_t);
+};
+
+class CzTraceWriter {
+	public:
+		CzTraceWriter(const char*, UINT32 chunk = 1 << 16, UINT32 lineShift = 6);
+		~CzTraceWriter();
+		bool good() const {
+			return out != NULL;
+		}
+		bool write(const Access*, size_t);
+		bool close();
+	private:
+		FILE* out;
+		CzHeader hdr;
+		std::vector<Access> pending;
+		std::vector<unsigned char> raw, zbuf;
+		std::vector<CzIndex> index;
+		std::vector<Addr_t> pcs;
+		std::unordered_map<Addr_t, COUNTER> dict;
+		bool flush();
+};
+
+#endif
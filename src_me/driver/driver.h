@@ -0,0 +1,86 @@
+#ifndef DRIVER_H
+#define DRIVER_H
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Shared pieces of the crcsim driver and its simulation modes                //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+#include "crc_cache.h"
+#include "trace.h"
+
+struct Options {
+	UINT32 threads, size, linesize, assoc, policy;
+	bool async;
+	const char *trace, *out;
+
+	// Interval sampling: intervals of intervalLen accesses, each warmed over
+	// the preceding warmup accesses, simulated on up to jobs threads
+	UINT32 intervals, jobs;
+	COUNTER intervalLen, warmup;
+
+	// Set-sharded simulation of the one configuration on this many threads
+	UINT32 shards;
+
+	// File listing the configurations of a sweep
+	const char* sweep;
+
+	// LRU miss ratio curve up to this many sets and ways
+	UINT32 mrcSets, mrcAssoc;
+
+	// Fraction of the sets simulated, 1 for all of them
+	double sample;
+
+	// Back the cache state with transparent huge pages
+	bool hugePages;
+
+	// Keep the compact line state (32-bit tags, no LINE_STATE copies)
+	bool compact;
+
+	// File the replacement policy internals go to as JSON
+	const char* policyStats;
+
+	// Prefix of the per-set and per-interval telemetry files, and the
+	// accesses per interval
+	const char* telemetry;
+	COUNTER telemetryInterval;
+
+	// Classify the misses as compulsory, capacity or conflict
+	bool threeC;
+
+	// File the per-PC profile goes to as CSV, and the PCs it lists
+	const char* pcProfile;
+	UINT32 pcProfileTop;
+};
+
+CRC_CACHE* newCache(const Options&);
+
+// Rejects records the cache cannot index
+void validate(const Access*, size_t, const Options&, const TraceReader*, COUNTER done);
+// Whether the len accesses of o.trace from access from on are at most
+// CRC_CACHE::ADDRESS_BITS wide, as the 32-bit tags of a compact cache need;
+// reports the first one that is not
+bool checkAddresses(const Options&, COUNTER from = 0, COUNTER len = ~0ull);
+// Feeds one batch to the cache, with the next use of every access for OPT
+void simulate(CRC_CACHE*, const Access*, size_t, const Options&, const TraceReader*, COUNTER done,
+		const COUNTER* next = NULL);
+
+void printDriverStats(ostream&, COUNTER accesses, double secs);
+// Writes the policy internals of the finished run to o.policyStats, if set
+void writePolicyStats(CRC_CACHE*, const Options&);
+// Writes the telemetry of the finished run to o.telemetry.*, if set
+void writeTelemetry(CRC_CACHE*, const Options&);
+// Writes the top PCs of the finished run to o.pcProfile, if set
+void writePCProfile(CRC_CACHE*, const Options&);
+
+// Interval sampling mode, see intervals.cpp
+int runIntervals(const Options&, ostream&);
+// Set-sharded mode, see shards.cpp
+int runShards(const Options&, ostream&);
+// Configuration sweep, see sweep.cpp
+int runSweep(const Options&, ostream&);
+// LRU miss ratio curve, see stackdist.cpp
+int runMrc(const Options&, ostream&);
+
+#endif
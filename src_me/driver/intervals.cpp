@@ -0,0 +1,139 @@
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Interval sampling. N intervals are spread evenly over a seekable trace,    //
+// each one is simulated on its own private cache after warming it over the   //
+// preceding accesses, and the interval miss ratios are combined into an      //
+// estimate for the whole run with a 95% confidence interval.                 //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+#include <cmath>
+#include <cstdio>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "driver.h"
+
+static const size_t BATCH = 1 << 14;
+
+struct Interval {
+	COUNTER start, warm, lookups, misses;
+	bool ok;
+};
+
+// Two-sided 97.5% quantiles of Student's t for 1..30 degrees of freedom
+static const double T975[] = {
+	12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+	2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+	2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+};
+
+static void runInterval(const Options& o, Interval& iv) {
+	TraceReader* tr(openTrace(o.trace));
+	iv.ok = false;
+	if (tr == NULL || !tr->seek(iv.warm)) {
+		delete tr;
+		return;
+	}
+	CRC_CACHE* cache(newCache(o));
+	std::vector<Access> buf(BATCH);
+	COUNTER pos(iv.warm), end(iv.start + o.intervalLen);
+	while (pos < end) {
+		if (pos == iv.start) {
+			cache->ResetStats();
+		}
+		COUNTER lim(pos < iv.start ? iv.start : end);
+		size_t n(tr->read(buf.data(), std::min((COUNTER)BATCH, lim - pos)));
+		if (n == 0) {
+			break;
+		}
+		simulate(cache, buf.data(), n, o, tr, pos);
+		pos += n;
+	}
+	iv.lookups = cache->TotalLookupStats();
+	iv.misses = cache->TotalMissStats();
+	iv.ok = (pos == end);
+	delete cache;
+	delete tr;
+}
+
+int runIntervals(const Options& o, ostream& out) {
+	TraceReader* tr(openTrace(o.trace));
+	if (tr == NULL) {
+		return 1;
+	}
+	COUNTER total(tr->count());
+	bool seekable(tr->seek(0));
+	delete tr;
+	if (!seekable || total == 0) {
+		fprintf(stderr, "%s: interval sampling needs a chunked trace (ctconv -chunk 65536)\n", o.trace);
+		return 1;
+	}
+	if (o.intervals == 0 || o.intervalLen == 0 || (COUNTER)o.intervals * o.intervalLen > total) {
+		fprintf(stderr, "%u intervals of %llu accesses do not fit in %llu accesses\n", o.intervals, o.intervalLen, total);
+		return 1;
+	}
+
+	std::vector<Interval> iv(o.intervals);
+	for (UINT32 i = 0; i < o.intervals; ++ i) {
+		COUNTER mid(total * (2 * i + 1) / (2 * o.intervals));
+		iv[i].start = std::min(mid - std::min(mid, o.intervalLen / 2), total - o.intervalLen);
+		iv[i].warm = iv[i].start - std::min(iv[i].start, o.warmup);
+	}
+	if (CRC_CACHE::Tags32(o.size << 10, o.assoc, o.linesize, o.compact)) {
+		for (UINT32 i = 0; i < o.intervals; ++ i) {
+			if (!checkAddresses(o, iv[i].warm, iv[i].start + o.intervalLen - iv[i].warm)) {
+				return 1;
+			}
+		}
+	}
+
+	std::atomic<UINT32> next(0);
+	std::vector<std::thread> workers;
+	UINT32 jobs(std::min(o.jobs ? o.jobs : std::max(1u, std::thread::hardware_concurrency()), o.intervals));
+	for (UINT32 j = 0; j < jobs; ++ j) {
+		workers.push_back(std::thread([&]() {
+			for (UINT32 i; (i = next ++) < o.intervals; ) {
+				runInterval(o, iv[i]);
+			}
+		}));
+	}
+	for (UINT32 j = 0; j < jobs; ++ j) {
+		workers[j].join();
+	}
+
+	double sum(0), sum2(0);
+	for (UINT32 i = 0; i < o.intervals; ++ i) {
+		if (!iv[i].ok) {
+			fprintf(stderr, "%s: cannot replay interval at access %llu\n", o.trace, iv[i].start);
+			return 1;
+		}
+		double r((double)iv[i].misses / iv[i].lookups);
+		sum += r, sum2 += r * r;
+	}
+	UINT32 n(o.intervals);
+	double mean(sum / n);
+	double var(n > 1 ? std::max(0., (sum2 - sum * mean) / (n - 1)) : 0);
+	// Finite population correction for the part of the trace that was measured
+	double fpc(1. - (double)n * o.intervalLen / total);
+	double t(n > 1 ? (n - 1 <= 30 ? T975[n - 2] : 1.96) : 0);
+	double err(t * sqrt(var / n * fpc));
+
+	out<<"=========================================================="<<endl;
+	out<<"============== Interval Sampling Statistics =============="<<endl;
+	out<<"=========================================================="<<endl;
+	out<<endl;
+	out<<"Sampling Configuration: "<<endl;
+	out<<"\tTrace Accesses: "<<total<<endl;
+	out<<"\tIntervals:      "<<n<<" x "<<o.intervalLen<<" accesses"<<endl;
+	out<<"\tWarmup:         "<<o.warmup<<" accesses"<<endl;
+	out<<endl;
+	for (UINT32 i = 0; i < n; ++ i) {
+		out<<"\tInterval: "<<i<<" Start: "<<iv[i].start<<" Lookups: "<<iv[i].lookups<<" Misses: "<<iv[i].misses
+			<<" Miss Rate: "<<(double)iv[i].misses / iv[i].lookups * 100.0<<endl;
+	}
+	out<<endl;
+	out<<"\tEstimated Misses:    "<<(COUNTER)(mean * total)<<" +- "<<(COUNTER)(err * total)<<" (95%)"<<endl;
+	out<<"\tEstimated Miss Rate: "<<mean * 100.0<<" +- "<<err * 100.0<<" (95%)"<<endl;
+	return 0;
+}
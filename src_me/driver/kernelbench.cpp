@@ -0,0 +1,86 @@
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Times the access path of the generic cache against the one compiled for    //
+// its associativity, for every specialized associativity with 64B lines,     //
+// and the latter once more fed in batches through LookupAndFillBatch.        //
+//                                                                            //
+//   bin/kernelbench [accesses] [sizeKB]                                      //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+#include "crc_cache.h"
+
+namespace {
+
+// Skewed synthetic stream: most accesses hit a hot region about the size of
+// the cache, the rest wander over a footprint eight times larger
+void makeStream(std::vector<Access>& acc, COUNTER n, UINT32 lines) {
+	COUNTER x(88172645463325252ull);
+	acc.resize(n);
+	for (COUNTER i = 0; i < n; ++ i) {
+		x ^= x << 13, x ^= x >> 7, x ^= x << 17;
+		Addr_t line(x % 4 ? (x >> 8) % lines : (x >> 8) % (8ull * lines));
+		acc[i].pc = 0x400000 + (i & 255) * 4;
+		acc[i].paddr = line << 6;
+		acc[i].tid = 0;
+		acc[i].type = ACCESS_LOAD;
+	}
+}
+
+double run(CRC_CACHE* cache, const std::vector<Access>& acc, bool batch, COUNTER& misses) {
+	const size_t BATCH(1 << 14);
+	std::chrono::steady_clock::time_point t0(std::chrono::steady_clock::now());
+	if (batch) {
+		for (size_t i = 0; i < acc.size(); i += BATCH) {
+			cache->LookupAndFillBatch(&acc[i], std::min(BATCH, acc.size() - i), NULL);
+		}
+	} else {
+		for (size_t i = 0; i < acc.size(); ++ i) {
+			cache->LookupAndFillCache(acc[i].tid, acc[i].pc, acc[i].paddr, acc[i].type);
+		}
+	}
+	std::chrono::duration<double, std::nano> dt(std::chrono::steady_clock::now() - t0);
+	misses = cache->TotalMissStats();
+	return dt.count() / acc.size();
+}
+
+}
+
+int main(int argc, char** argv) {
+	COUNTER n(argc > 1 ? strtoull(argv[1], NULL, 10) : 10000000);
+	UINT32 sizeKB(argc > 2 ? atoi(argv[2]) : 1024);
+	// OPT needs a next-use column and MLRU is not usable, so neither is timed
+	const char* policies[] = { "lru", "random", "lirsplus" };
+	const UINT32 assocs[] = { 4, 8, 16, 32 };
+
+	std::vector<Access> acc;
+	makeStream(acc, n, sizeKB * 1024 / 64);
+
+	printf("policy,assoc,generic_ns,specialized_ns,speedup,batched_ns\n");
+	for (size_t p = 0; p < sizeof(policies) / sizeof(*policies); ++ p) {
+		const CRC_POLICY_OPS* ops(CRC_FindPolicy(policies[p]));
+		for (size_t a = 0; a < sizeof(assocs) / sizeof(*assocs); ++ a) {
+			// Generic, specialized, specialized in batches
+			double ns[3];
+			COUNTER misses[3];
+			for (int s = 0; s < 3; ++ s) {
+				srand(1);
+				CRC_CACHE* cache(CRC_NewCache(sizeKB * 1024, assocs[a], 1, 64, ops->id, false, s > 0));
+				ns[s] = run(cache, acc, s == 2, misses[s]);
+				delete cache;
+			}
+			if (misses[0] != misses[1] || misses[0] != misses[2]) {
+				fprintf(stderr, "%s %u: specialized cache disagrees (%llu vs %llu vs %llu misses)\n",
+						policies[p], assocs[a], misses[0], misses[1], misses[2]);
+				return 1;
+			}
+			printf("%s,%u,%.2f,%.2f,%.2f,%.2f\n", policies[p], assocs[a], ns[0], ns[1], ns[0] / ns[1], ns[2]);
+		}
+	}
+	return 0;
+}
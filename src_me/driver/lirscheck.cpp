@@ -0,0 +1,315 @@
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Checks the hashed, bounded LIRSplus stack of one set against a reference   //
+// that scans the stack linearly, as the policy did before the hash, and      //
+// drops the oldest non-resident entry past the same bound. Both sets see     //
+// the same synthetic stream as the cache would feed them, a victim and an    //
+// update per miss, and must pick the same victims and count the same ghost   //
+// hits and drops, for histories of 0, 2 and 8 entries and the default one.   //
+//                                                                            //
+// LIRSplus promotes every fill and demotes the bottom LIR line for it, so a  //
+// set keeps a single LIR line and the stack is pruned down to it on every    //
+// miss: a non-resident entry lives only until the fill that made it is       //
+// done, which max_ghosts shows and the default depth of 1 is sized for. A    //
+// history of 0 drops it at once, the only depth at which the drop path runs. //
+//                                                                            //
+//   bin/lirscheck [accesses]                                                 //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "crc_cache.h"
+#include "replacement_state.h"
+
+namespace {
+
+// The policy as it was before the hash: the stack is scanned linearly, a
+// vector from the bottom up; since orders the non-resident entries
+class Reference {
+	public:
+		Reference(int _n, int _gmax) : n(_n), gmax(_gmax), qsz(2 * _n), a(_n), q(2 * _n) {
+			for (int i = 0; i < n; ++ i) {
+				a[i].pa = 0, a[i].pq = i - 1, a[i].heat = 2 | (i == 0);
+				Node x = { 0, i, 0 };
+				st.push_back(x);
+			}
+			for (int i = 0; i + 1 < n; ++ i) {
+				q[i] = i + 1;
+			}
+			qh = 0, qt = n - 1;
+			cnt = 0, temp_thres = 38, now = 0, ghosts = maxGhosts = 0;
+			std::fill(temp_cnt, temp_cnt + 67, 0);
+			ghostHits = ghostDrops = 0;
+		}
+		int way(Addr_t pa) const {
+			for (int i = 0; i < n; ++ i) {
+				if (a[i].pa == pa) {
+					return i;
+				}
+			}
+			return -1;
+		}
+		int getVictim(Addr_t pa) {
+			int res(q[qh]);
+			if (a[res].heat & 2) {
+				Node& x(st[node(res)]);
+				x.way = -1, x.since = ++ now;
+				maxGhosts = std::max(maxGhosts, ++ ghosts);
+				// Bounded history: the oldest non-resident entry goes
+				if (ghosts > gmax) {
+					++ ghostDrops;
+					size_t o(st.size());
+					for (size_t i = 0; i < st.size(); ++ i) {
+						if (st[i].way == -1 && (o == st.size() || st[i].since < st[o].since)) {
+							o = i;
+						}
+					}
+					erase(o);
+				}
+			}
+			qh = qnext(qh);
+			a[res].pa = pa;
+			for (size_t m = 0; m < st.size(); ++ m) {
+				if (st[m].pa == pa) {
+					if (st[m].way == -1) {
+						++ ghostHits;
+						-- ghosts;
+					}
+					st[m].way = res;
+					a[res].heat = 3;
+					moveToTop(res);
+					rmButton();
+					return res;
+				}
+			}
+			a[res].heat = 2;
+			push(pa, res);
+			q[a[res].pq = qt] = res;
+			qt = qnext(qt);
+			return res;
+		}
+		void update(int w) {
+			if (a[w].heat & 1) {
+				moveToTop(w);
+				rmHIR();
+			} else if (a[w].heat & 2) {
+				rmFromQueue(a[w].pq);
+				a[w].heat |= 1;
+				moveToTop(w);
+				rmHIR();
+				rmButton();
+			} else {
+				a[w].heat |= 2;
+				push(a[w].pa, w);
+			}
+		}
+		COUNTER ghostHits, ghostDrops;
+		int maxGhosts;
+	private:
+		struct Way {
+			Addr_t pa;
+			int pq, heat;
+		};
+		struct Node {
+			Addr_t pa;
+			int way;
+			COUNTER since;
+		};
+		int n, gmax, qsz, qh, qt, cnt, temp_thres, ghosts;
+		int temp_cnt[67];
+		COUNTER now;
+		std::vector<Way> a;
+		std::vector<int> q;
+		std::vector<Node> st;
+		int qprev(int p) const {
+			return p == 0 ? qsz - 1 : p - 1;
+		}
+		int qnext(int p) const {
+			return p == qsz - 1 ? 0 : p + 1;
+		}
+		size_t node(int w) const {
+			size_t i(0);
+			for (; st[i].way != w; ++ i);
+			return i;
+		}
+		void push(Addr_t pa, int w) {
+			Node x = { pa, w, 0 };
+			st.push_back(x);
+		}
+		void erase(size_t i) {
+			if (st[i].way == -1) {
+				-- ghosts;
+			}
+			st.erase(st.begin() + i);
+		}
+		void moveToTop(int w) {
+			size_t i(node(w));
+			Node x(st[i]);
+			st.erase(st.begin() + i);
+			x.pa = a[w].pa;
+			st.push_back(x);
+		}
+		void rmFromQueue(int p) {
+			for (; qnext(p) != qt; p = qnext(p)) {
+				q[p] = q[qnext(p)];
+				a[q[p]].pq = p;
+			}
+			qt = qprev(qt);
+		}
+		int getTempreture(Addr_t pa) const {
+			int res(63);
+			for (size_t i = 0; i < st.size(); ++ i) {
+				int s;
+				for (s = 63; s >= 0 && !(((pa ^ st[i].pa) >> s) & 1); -- s);
+				res = std::min(res, s);
+			}
+			return res;
+		}
+		void adjustTempreture(int t) {
+			if (t == -1) {
+				return;
+			}
+			++ temp_cnt[t];
+			if ((++ cnt & 0xf) == 0) {
+				int s(0);
+				for (temp_thres = 0; s < (cnt >> 1) && temp_thres < 30; ++ temp_thres) {
+					s += temp_cnt[temp_thres];
+				}
+			}
+		}
+		void rmButton() {
+			int rmi(st[0].way);
+			erase(0);
+			if (rmi > -1) {
+				a[q[qt] = rmi].heat = 0;
+				int temp(getTempreture(a[rmi].pa));
+				adjustTempreture(temp);
+				if (temp > temp_thres) {
+					a[rmi].pq = qh = qprev(qh);
+				} else {
+					a[rmi].pq = qt;
+					qt = qnext(qt);
+				}
+			}
+			rmHIR();
+		}
+		void rmHIR() {
+			while (!st.empty()) {
+				int rmi(st[0].way);
+				if (rmi > -1) {
+					if (a[rmi].heat & 1) {
+						break;
+					}
+					a[rmi].heat &= ~2;
+				}
+				erase(0);
+			}
+		}
+};
+
+// One set of the policy itself, laid out as the cache lays it out
+class Set {
+	public:
+		Set(int _n, int g) : n(_n), a(_n), mem(LIRSplus::Bytes(_n, g)) {
+			for (int i = 0; i < n; ++ i) {
+				a[i].pa = 0;
+				a[i].LRUstackposition = i;
+				a[i].pq = i - 1;
+				a[i].heat = 2 | (i == 0);
+			}
+			lirs = new (&mem[0]) LIRSplus;
+			lirs->init(n, g, &mem[0] + sizeof(LIRSplus));
+		}
+		~Set() {
+			lirs->~LIRSplus();
+		}
+		int way(Addr_t pa) const {
+			for (int i = 0; i < n; ++ i) {
+				if (a[i].pa == pa) {
+					return i;
+				}
+			}
+			return -1;
+		}
+		int getVictim(Addr_t pa) {
+			return lirs->getVictim(&a[0], pa);
+		}
+		void update(int w) {
+			lirs->update(&a[0], w);
+		}
+		LIRSplus* lirs;
+	private:
+		int n;
+		std::vector<LIRS_LINE_STATE> a;
+		std::vector<char> mem;
+};
+
+// Skewed stream over one set: most accesses go to about twice the ways,
+// the rest to eight times as many lines, none at address zero
+void makeStream(std::vector<Addr_t>& acc, COUNTER n, UINT32 ways) {
+	COUNTER x(88172645463325252ull);
+	acc.resize(n);
+	for (COUNTER i = 0; i < n; ++ i) {
+		x ^= x << 13, x ^= x >> 7, x ^= x << 17;
+		Addr_t line(x % 4 ? (x >> 8) % (2 * ways) : (x >> 8) % (8 * ways));
+		acc[i] = (line + 1) << 6;
+	}
+}
+
+// Feeds both sets the stream; 0 if they agree on every hit, victim and count
+int run(const std::vector<Addr_t>& acc, UINT32 ways, UINT32 g) {
+	Set s(ways, g);
+	Reference r(ways, g);
+	COUNTER hits(0);
+	for (size_t i = 0; i < acc.size(); ++ i) {
+		int w(s.way(acc[i])), rw(r.way(acc[i]));
+		if (w != rw) {
+			fprintf(stderr, "%u ways, %u ghosts: access %zu hits way %d, the reference way %d\n", ways, g, i, w, rw);
+			return 1;
+		}
+		if (w > -1) {
+			++ hits;
+			continue;
+		}
+		w = s.getVictim(acc[i]);
+		rw = r.getVictim(acc[i]);
+		if (w != rw) {
+			fprintf(stderr, "%u ways, %u ghosts: access %zu evicts way %d, the reference way %d\n", ways, g, i, w, rw);
+			return 1;
+		}
+		s.update(w);
+		r.update(w);
+	}
+	COUNTER ghostHits(s.lirs->counts[LIRSplus::GHOST_HITS]), ghostDrops(s.lirs->counts[LIRSplus::GHOST_DROPS]);
+	if (ghostHits != r.ghostHits || ghostDrops != r.ghostDrops) {
+		fprintf(stderr, "%u ways, %u ghosts: %llu ghost hits and %llu drops, the reference %llu and %llu\n",
+				ways, g, ghostHits, ghostDrops, r.ghostHits, r.ghostDrops);
+		return 1;
+	}
+	printf("%u,%u,%llu,%llu,%llu,%d\n", ways, g, hits, ghostHits, ghostDrops, r.maxGhosts);
+	return 0;
+}
+
+}
+
+int main(int argc, char** argv) {
+	COUNTER n(argc > 1 ? strtoull(argv[1], NULL, 10) : 200000);
+	const UINT32 assocs[] = { 4, 16 };
+	// The default depth of the cache last
+	const UINT32 depths[] = { 0, 2, 8 };
+
+	printf("assoc,ghosts,hits,ghost_hits,ghost_drops,max_ghosts\n");
+	for (size_t a = 0; a < sizeof(assocs) / sizeof(*assocs); ++ a) {
+		std::vector<Addr_t> acc;
+		makeStream(acc, n, assocs[a]);
+		for (size_t d = 0; d <= sizeof(depths) / sizeof(*depths); ++ d) {
+			UINT32 g(d < sizeof(depths) / sizeof(*depths) ? depths[d] : CACHE_REPLACEMENT_STATE::GhostDepth(0));
+			if (run(acc, assocs[a], g)) {
+				return 1;
+			}
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,97 @@
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <unordered_map>
+#include <unistd.h>
+#include "nextuse.h"
+
+static const size_t BLOCK = 1 << 16;
+
+// Unlinked scratch file, gone with the descriptor
+static int scratch() {
+	char name[] = "/tmp/crcsimXXXXXX";
+	int fd(mkstemp(name));
+	if (fd < 0) {
+		perror("mkstemp");
+		return -1;
+	}
+	unlink(name);
+	return fd;
+}
+
+static bool writeAll(int fd, const COUNTER* p, size_t n, COUNTER at) {
+	size_t len(n * sizeof(COUNTER));
+	return pwrite(fd, p, len, at * sizeof(COUNTER)) == (ssize_t)len;
+}
+
+static bool readAll(int fd, COUNTER* p, size_t n, COUNTER at) {
+	size_t len(n * sizeof(COUNTER));
+	return pread(fd, p, len, at * sizeof(COUNTER)) == (ssize_t)len;
+}
+
+NextUseColumn::NextUseColumn() : lines(-1), next(-1), total(0), done(0) {
+}
+
+NextUseColumn::~NextUseColumn() {
+	if (lines >= 0) {
+		close(lines);
+	}
+	if (next >= 0) {
+		close(next);
+	}
+}
+
+bool NextUseColumn::build(TraceReader* tr, UINT32 lineShift) {
+	if ((lines = scratch()) < 0 || (next = scratch()) < 0) {
+		return false;
+	}
+	std::vector<Access> buf(BLOCK);
+	std::vector<COUNTER> col(BLOCK);
+	total = 0;
+	for (size_t n; (n = tr->read(buf.data(), BLOCK)) > 0; total += n) {
+		for (size_t i = 0; i < n; ++ i) {
+			col[i] = buf[i].paddr >> lineShift;
+		}
+		if (!writeAll(lines, col.data(), n, total)) {
+			perror("next-use pass");
+			return false;
+		}
+	}
+
+	// Walk the blocks from the end, each line remembers its latest index
+	std::unordered_map<Addr_t, COUNTER> seen;
+	for (COUNTER end = total; end > 0; ) {
+		size_t n(std::min((COUNTER)BLOCK, end));
+		end -= n;
+		if (!readAll(lines, col.data(), n, end)) {
+			perror("next-use pass");
+			return false;
+		}
+		for (size_t i = n; i -- > 0; ) {
+			std::pair<std::unordered_map<Addr_t, COUNTER>::iterator, bool> r(seen.insert(std::make_pair(col[i], end + i)));
+			COUNTER after(r.second ? NEVER : r.first->second);
+			r.first->second = end + i;
+			col[i] = after;
+		}
+		if (!writeAll(next, col.data(), n, end)) {
+			perror("next-use pass");
+			return false;
+		}
+	}
+	close(lines);
+	lines = -1;
+	done = 0;
+	return true;
+}
+
+size_t NextUseColumn::read(COUNTER* p, size_t n) {
+	if (n > total - done) {
+		n = total - done;
+	}
+	if (!readAll(next, p, n, done)) {
+		perror("next-use column");
+		exit(1);
+	}
+	done += n;
+	return n;
+}
@@ -0,0 +1,36 @@
+#ifndef NEXTUSE_H
+#define NEXTUSE_H
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Next-use column for Belady's OPT. A forward pass spills the line address   //
+// of every access to a temporary file, a reverse pass over that file then    //
+// writes, for each access, the index of the next access to the same line.    //
+// Replay streams the column back in order, so only the table of distinct     //
+// lines is held in memory, never the trace.                                  //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+#include <vector>
+#include "trace.h"
+
+class NextUseColumn {
+	public:
+		static const COUNTER NEVER = ~0ull;
+
+		NextUseColumn();
+		~NextUseColumn();
+
+		// Consumes the reader, false on I/O errors
+		bool build(TraceReader*, UINT32 lineShift);
+		// Next uses of the following n accesses, in trace order
+		size_t read(COUNTER*, size_t n);
+		COUNTER count() const {
+			return total;
+		}
+	private:
+		int lines, next;
+		COUNTER total, done;
+};
+
+#endif
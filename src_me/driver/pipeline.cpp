@@ -0,0 +1,142 @@
+#include <chrono>
+#include <algorithm>
+#include <cstring>
+#include "pipeline.h"
+
+static inline COUNTER nowNs() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+AsyncTraceReader::AsyncTraceReader(TraceReader* _src) : src(_src) {
+	path = src->name();
+	ring = new Slot[SLOTS];
+	head = tail = 0;
+	stop = false;
+	decodeWait = simulateWait = 0;
+	pos = 0;
+	worker = std::thread(&AsyncTraceReader::decode, this);
+}
+
+AsyncTraceReader::~AsyncTraceReader() {
+	stop = true;
+	worker.join();
+	delete [] ring;
+	delete src;
+}
+
+void AsyncTraceReader::decode() {
+	for (COUNTER t = 0; ; ++ t) {
+		if (t - head.load(std::memory_order_acquire) == SLOTS) {
+			COUNTER s(nowNs());
+			while (t - head.load(std::memory_order_acquire) == SLOTS) {
+				if (stop) {
+					return;
+				}
+				std::this_thread::yield();
+			}
+			decodeWait += nowNs() - s;
+		}
+		Slot& slot(ring[t % SLOTS]);
+		slot.n = src->read(slot.a, BATCH);
+		tail.store(t + 1, std::memory_order_release);
+		// An empty batch tells the consumer that the trace is over
+		if (slot.n == 0) {
+			return;
+		}
+	}
+}
+
+const Access* AsyncTraceReader::acquire(size_t& n) {
+	COUNTER h(head.load(std::memory_order_relaxed));
+	if (h == tail.load(std::memory_order_acquire)) {
+		COUNTER s(nowNs());
+		while (h == tail.load(std::memory_order_acquire)) {
+			std::this_thread::yield();
+		}
+		simulateWait += nowNs() - s;
+	}
+	const Slot& slot(ring[h % SLOTS]);
+	n = slot.n;
+	return n ? slot.a : NULL;
+}
+
+void AsyncTraceReader::release() {
+	head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+size_t AsyncTraceReader::read(Access* a, size_t n) {
+	size_t k(0);
+	while (k < n) {
+		size_t m;
+		const Access* b(acquire(m));
+		if (b == NULL) {
+			break;
+		}
+		size_t c(std::min(n - k, m - pos));
+		memcpy(a + k, b + pos, c * sizeof(Access));
+		k += c;
+		if ((pos += c) == m) {
+			pos = 0;
+			release();
+		}
+	}
+	return k;
+}
+
+BatchBroadcast::BatchBroadcast(UINT32 _consumers) : consumers(_consumers) {
+	ring = new Slot[SLOTS];
+	for (size_t i = 0; i < SLOTS; ++ i) {
+		ring[i].n = 0;
+		ring[i].pending = 0;
+	}
+	tail = 0;
+	produceWait = 0;
+}
+
+BatchBroadcast::~BatchBroadcast() {
+	delete [] ring;
+}
+
+Access* BatchBroadcast::claim() {
+	Slot& slot(ring[tail.load(std::memory_order_relaxed) % SLOTS]);
+	if (slot.pending.load(std::memory_order_acquire)) {
+		COUNTER s(nowNs());
+		while (slot.pending.load(std::memory_order_acquire)) {
+			std::this_thread::yield();
+		}
+		produceWait += nowNs() - s;
+	}
+	return slot.a;
+}
+
+void BatchBroadcast::publish(size_t n) {
+	COUNTER t(tail.load(std::memory_order_relaxed));
+	Slot& slot(ring[t % SLOTS]);
+	slot.n = n;
+	slot.pending.store(consumers, std::memory_order_relaxed);
+	tail.store(t + 1, std::memory_order_release);
+}
+
+void BatchBroadcast::drain() {
+	COUNTER s(nowNs());
+	for (size_t i = 0; i < SLOTS; ++ i) {
+		while (ring[i].pending.load(std::memory_order_acquire)) {
+			std::this_thread::yield();
+		}
+	}
+	produceWait += nowNs() - s;
+}
+
+const Access* BatchBroadcast::acquire(COUNTER seq, size_t& n) {
+	while (!ready(seq)) {
+		std::this_thread::yield();
+	}
+	const Slot& slot(ring[seq % SLOTS]);
+	n = slot.n;
+	return n ? slot.a : NULL;
+}
+
+void BatchBroadcast::release(COUNTER seq) {
+	ring[seq % SLOTS].pending.fetch_sub(1, std::memory_order_release);
+}
@@ -0,0 +1,102 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Asynchronous trace decoding. A decoder thread fills fixed-size batches of  //
+// a single-producer/single-consumer ring while the simulation thread drains  //
+// them, so inflating and parsing overlap with the cache model.               //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+#include <atomic>
+#include <thread>
+#include "trace.h"
+
+class AsyncTraceReader : public TraceReader {
+	public:
+		static const size_t BATCH = 1 << 12;
+		static const size_t SLOTS = 16;
+
+		// Takes ownership of the source reader
+		AsyncTraceReader(TraceReader*);
+		~AsyncTraceReader();
+
+		// Zero-copy consumer side: the next batch stays valid until release(),
+		// NULL marks the end of the trace
+		const Access* acquire(size_t& n);
+		void release();
+
+		size_t read(Access*, size_t);
+
+		// Seconds the decoder waited for a free slot, i.e. the simulator was
+		// the bottleneck, and seconds the simulator waited for a full one
+		double decodeStall() const {
+			return decodeWait * 1e-9;
+		}
+		double simulateStall() const {
+			return simulateWait * 1e-9;
+		}
+	private:
+		struct Slot {
+			Access a[BATCH];
+			size_t n;
+		};
+
+		TraceReader* src;
+		Slot* ring;
+		// head is the next slot to consume, tail the next one to fill
+		alignas(64) std::atomic<COUNTER> head;
+		alignas(64) std::atomic<COUNTER> tail;
+		std::atomic<bool> stop;
+		COUNTER decodeWait, simulateWait;
+		size_t pos;
+		std::thread worker;
+
+		void decode();
+};
+
+// Single producer, several consumers that each see every batch. A slot is
+// refilled only after all consumers released it, consumers walk the stream
+// with their own sequence numbers.
+class BatchBroadcast {
+	public:
+		static const size_t BATCH = 1 << 12;
+		static const size_t SLOTS = 32;
+
+		BatchBroadcast(UINT32 consumers);
+		~BatchBroadcast();
+
+		// Producer side: fill the claimed slot, then publish it; publishing
+		// an empty batch ends the stream
+		Access* claim();
+		void publish(size_t n);
+		// Waits until every consumer released every published batch
+		void drain();
+
+		// Consumer side: waits for batch seq, NULL at the end of the stream
+		const Access* acquire(COUNTER seq, size_t& n);
+		// Non-blocking variant, false if batch seq is not published yet
+		bool ready(COUNTER seq) const {
+			return seq < tail.load(std::memory_order_acquire);
+		}
+		void release(COUNTER seq);
+
+		// Seconds the producer waited for the slowest consumer
+		double produceStall() const {
+			return produceWait * 1e-9;
+		}
+	private:
+		struct Slot {
+			Access a[BATCH];
+			size_t n;
+			std::atomic<UINT32> pending;
+		};
+
+		UINT32 consumers;
+		Slot* ring;
+		alignas(64) std::atomic<COUNTER> tail;
+		COUNTER produceWait;
+};
+
+#endif
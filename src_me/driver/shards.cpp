@@ -0,0 +1,111 @@
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Set-sharded simulation of a single configuration. Every policy keeps its   //
+// state per set, so worker w owns the sets [w*S/n, (w+1)*S/n) and replays    //
+// only the accesses that map to them, in trace order. The main thread        //
+// decodes the trace into a broadcast ring that all workers read. Results     //
+// are identical to the serial run for every policy but random replacement,   //
+// whose draws depend on the global access order.                             //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+#include <cstdio>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "driver.h"
+#include "pipeline.h"
+
+struct Shard {
+	UINT32 lo, hi;
+	// Indexed by accessType * threads + tid
+	std::vector<COUNTER> lookups, hits;
+};
+
+static void runShard(CRC_CACHE* cache, BatchBroadcast& bc, Shard& sh) {
+	UINT32 threads(sh.lookups.size() / ACCESS_MAX);
+	size_t n;
+	const Access* a;
+	for (COUNTER seq = 0; (a = bc.acquire(seq, n)) != NULL; bc.release(seq ++)) {
+		for (size_t i = 0; i < n; ++ i) {
+			UINT32 s(cache->GetSetIndex(a[i].paddr));
+			if (s >= sh.lo && s < sh.hi) {
+				UINT32 k(a[i].type * threads + a[i].tid);
+				++ sh.lookups[k];
+				sh.hits[k] += cache->LookupAndFill(a[i].tid, a[i].pc, a[i].paddr, a[i].type);
+			}
+		}
+	}
+}
+
+int runShards(const Options& o, ostream& out) {
+	if (o.policy == CRC_REPL_RANDOM) {
+		fprintf(stderr, "random replacement cannot be sharded, its draws depend on the access order\n");
+		return 1;
+	}
+	TraceReader* tr(openTrace(o.trace));
+	if (tr == NULL) {
+		return 1;
+	}
+	CRC_CACHE* cache(newCache(o));
+	cache->PrintMemory(cerr);
+	if (cache->Tags32() && !checkAddresses(o)) {
+		return 1;
+	}
+	UINT32 sets(cache->NumSets()), n(std::min(o.shards, sets));
+
+	BatchBroadcast bc(n);
+	std::vector<Shard> sh(n);
+	std::vector<std::thread> workers;
+	for (UINT32 w = 0; w < n; ++ w) {
+		sh[w].lo = (COUNTER)sets * w / n;
+		sh[w].hi = (COUNTER)sets * (w + 1) / n;
+		sh[w].lookups.assign(ACCESS_MAX * o.threads, 0);
+		sh[w].hits.assign(ACCESS_MAX * o.threads, 0);
+		workers.push_back(std::thread(runShard, cache, std::ref(bc), std::ref(sh[w])));
+	}
+
+	// The policy samples its state when the time reaches due, with the due - 1
+	// accesses before made: a batch ends there, and once the trace goes on
+	// and the workers are idle the time is moved up to due
+	COUNTER total(0), time(0);
+	std::chrono::steady_clock::time_point start(std::chrono::steady_clock::now());
+	for (size_t k; ; total += k) {
+		Access* b(bc.claim());
+		COUNTER due(cache->NextSample()), room(total + 1 < due ? due - 1 - total : 1);
+		k = tr->read(b, std::min((COUNTER)BatchBroadcast::BATCH, room));
+		validate(b, k, o, tr, total);
+		if (k && total + 1 == due) {
+			bc.drain();
+			cache->AddTime(due - time);
+			time = due;
+		}
+		bc.publish(k);
+		if (k == 0) {
+			break;
+		}
+	}
+	for (UINT32 w = 0; w < n; ++ w) {
+		workers[w].join();
+	}
+	double secs(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+
+	for (UINT32 w = 0; w < n; ++ w) {
+		for (UINT32 a = 0; a < ACCESS_MAX; ++ a) {
+			for (UINT32 t = 0; t < o.threads; ++ t) {
+				cache->AddStats(t, a, sh[w].lookups[a * o.threads + t], sh[w].hits[a * o.threads + t]);
+			}
+		}
+	}
+	cache->AddTime(total - time);
+
+	cache->PrintStats(out);
+	printDriverStats(out, total, secs);
+	writePolicyStats(cache, o);
+	out<<"\tShards:         "<<n<<endl;
+	out<<"\tDecode stall:   "<<bc.produceStall()<<"s"<<endl;
+
+	delete cache;
+	delete tr;
+	return 0;
+}
@@ -0,0 +1,106 @@
+#include <cstdio>
+#include <algorithm>
+#include "stackdist.h"
+#include "driver.h"
+
+StackDistance::StackDistance(UINT32 _levels, UINT32 _maxAssoc)
+	: levels(_levels), maxAssoc(_maxAssoc), now(0) {
+	sets.resize(levels + 1);
+	hist.resize(levels + 1);
+	cold.assign(levels + 1, 0);
+	for (UINT32 l = 0; l <= levels; ++ l) {
+		sets[l].resize(1u << l);
+		hist[l].assign(maxAssoc + 1, 0);
+	}
+}
+
+// Drops dead entries and makes room for as many appends as there are live ones
+void StackDistance::compact(Set& s) {
+	size_t k(0);
+	for (size_t i = 0; i < s.time.size(); ++ i) {
+		if (s.alive[i]) {
+			s.time[k ++] = s.time[i];
+		}
+	}
+	s.time.resize(k);
+	s.alive.assign(k, 1);
+	s.bt.assign(std::max((size_t)64, 2 * k) + 1, 0);
+	for (size_t p = 1; p < s.bt.size(); ++ p) {
+		s.bt[p] += (p <= k);
+		size_t q(p + (p & -p));
+		if (q < s.bt.size()) {
+			s.bt[q] += s.bt[p];
+		}
+	}
+}
+
+void StackDistance::access(Addr_t line) {
+	std::unordered_map<Addr_t, COUNTER>::iterator it(last.find(line));
+	for (UINT32 l = 0; l <= levels; ++ l) {
+		Set& s(sets[l][line & ((1ull << l) - 1)]);
+		if (it != last.end()) {
+			size_t i(std::lower_bound(s.time.begin(), s.time.end(), it->second) - s.time.begin());
+			// Lines touched in this set since the last access of this one
+			UINT32 d(s.live - btQry(s.bt, i + 1));
+			++ hist[l][std::min(d, maxAssoc)];
+			btChg(s.bt, i + 1, -1);
+			s.alive[i] = 0;
+			-- s.live;
+		} else {
+			++ cold[l];
+		}
+		if (s.time.size() + 1 >= s.bt.size()) {
+			compact(s);
+		}
+		s.time.push_back(now);
+		s.alive.push_back(1);
+		btChg(s.bt, s.time.size(), 1);
+		++ s.live;
+	}
+	if (it != last.end()) {
+		it->second = now;
+	} else {
+		last.insert(std::make_pair(line, now));
+	}
+	++ now;
+}
+
+COUNTER StackDistance::misses(UINT32 level, UINT32 assoc) const {
+	COUNTER m(cold[level]);
+	for (UINT32 d = std::min(assoc, maxAssoc); d <= maxAssoc; ++ d) {
+		m += hist[level][d];
+	}
+	return m;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Miss ratio curve mode: one CSV row per set count and associativity         //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+int runMrc(const Options& o, ostream& out) {
+	TraceReader* tr(openTrace(o.trace));
+	if (tr == NULL) {
+		return 1;
+	}
+	UINT32 levels(CRC_FloorLog2(o.mrcSets)), lineShift(CRC_FloorLog2(o.linesize));
+	StackDistance sd(levels, o.mrcAssoc);
+	std::vector<Access> buf(1 << 14);
+	COUNTER total(0);
+	for (size_t n; (n = tr->read(buf.data(), buf.size())) > 0; total += n) {
+		validate(buf.data(), n, o, tr, total);
+		for (size_t i = 0; i < n; ++ i) {
+			sd.access(buf[i].paddr >> lineShift);
+		}
+	}
+	out<<"sets,assoc,size_kb,lookups,misses,miss_rate"<<endl;
+	for (UINT32 l = 0; l <= levels; ++ l) {
+		for (UINT32 a = 1; a <= o.mrcAssoc; ++ a) {
+			COUNTER m(sd.misses(l, a));
+			out<<(1u << l)<<","<<a<<","<<((COUNTER)o.linesize * a << l) / 1024.<<","
+				<<total<<","<<m<<","<<(total ? (double)m / total : 0)<<endl;
+		}
+	}
+	delete tr;
+	return 0;
+}
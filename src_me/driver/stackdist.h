@@ -0,0 +1,63 @@
+#ifndef STACKDIST_H
+#define STACKDIST_H
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// One-pass Mattson stack distance analysis for LRU. For every power-of-two   //
+// set count up to 2^levels the per-set reuse distance of each access is      //
+// found with a Fenwick tree, so the LRU misses of every set count and        //
+// associativity come out of a single pass over the trace.                    //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+#include <vector>
+#include <unordered_map>
+#include "utils.h"
+
+class StackDistance {
+	public:
+		// Set counts 1, 2, .., 2^levels; distances of maxAssoc and up only
+		// count as misses
+		StackDistance(UINT32 levels, UINT32 maxAssoc);
+		void access(Addr_t line);
+		// LRU misses with 2^level sets of the given associativity
+		COUNTER misses(UINT32 level, UINT32 assoc) const;
+		COUNTER accesses() const {
+			return now;
+		}
+	private:
+		// Last accesses of the lines of one set in time order. An entry is
+		// alive while it is still the most recent access of its line, the
+		// Fenwick tree counts alive entries.
+		struct Set {
+			std::vector<COUNTER> time;
+			std::vector<char> alive;
+			std::vector<int> bt;
+			UINT32 live;
+			Set() : live(0) {}
+		};
+
+		UINT32 levels, maxAssoc;
+		COUNTER now;
+		std::unordered_map<Addr_t, COUNTER> last;
+		std::vector<std::vector<Set> > sets;
+		// hist[level][d] for d < maxAssoc, hist[level][maxAssoc] for the rest
+		std::vector<std::vector<COUNTER> > hist;
+		std::vector<COUNTER> cold;
+
+		static void btChg(std::vector<int>& t, size_t p, int v) {
+			for (; p < t.size(); p += (p & -p)) {
+				t[p] += v;
+			}
+		}
+		static int btQry(const std::vector<int>& t, size_t p) {
+			int s(0);
+			for (; p; p -= (p & -p)) {
+				s += t[p];
+			}
+			return s;
+		}
+		void compact(Set&);
+};
+
+#endif
@@ -0,0 +1,217 @@
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Configuration sweep. Every line of the sweep file names one cache as       //
+//                                                                            //
+//   size(KB):linesize:assoc:policy                                           //
+//                                                                            //
+// with the policy given by number or by name.                                //
+//                                                                            //
+// The trace is decoded once into a broadcast ring that all caches read, and  //
+// the caches advance on a work-stealing pool: a task moves one cache over    //
+// the batches published so far and is then queued again, idle workers steal  //
+// tasks from the back of the other queues. The result is one CSV row per     //
+// configuration, with the policy by name and the counts scaled to the whole  //
+// cache under -sample.                                                       //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+#include <cstdio>
+#include <cstring>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "driver.h"
+#include "pipeline.h"
+
+// Batches a task simulates before yielding its worker
+static const UINT32 QUANTUM = 8;
+
+struct SweepCache {
+	UINT32 size, linesize, assoc, policy;
+	CRC_CACHE* cache;
+	COUNTER seq;
+};
+
+struct WorkQueue {
+	std::mutex lock;
+	std::deque<UINT32> tasks;
+};
+
+class SweepPool {
+	public:
+		SweepPool(std::vector<SweepCache>& _caches, BatchBroadcast& _bc, UINT32 workers)
+			: caches(_caches), bc(_bc), queues(workers) {
+			left = caches.size();
+			for (UINT32 i = 0; i < caches.size(); ++ i) {
+				queues[i % workers].tasks.push_back(i);
+			}
+			for (UINT32 w = 0; w < workers; ++ w) {
+				threads.push_back(std::thread(&SweepPool::work, this, w));
+			}
+		}
+		void join() {
+			for (size_t w = 0; w < threads.size(); ++ w) {
+				threads[w].join();
+			}
+		}
+	private:
+		std::vector<SweepCache>& caches;
+		BatchBroadcast& bc;
+		std::vector<WorkQueue> queues;
+		std::vector<std::thread> threads;
+		std::atomic<UINT32> left;
+
+		bool pop(UINT32 w, UINT32& t) {
+			for (size_t k = 0; k < queues.size(); ++ k) {
+				WorkQueue& q(queues[(w + k) % queues.size()]);
+				std::lock_guard<std::mutex> g(q.lock);
+				if (!q.tasks.empty()) {
+					// Own work from the front, stolen work from the back
+					if (k == 0) {
+						t = q.tasks.front();
+						q.tasks.pop_front();
+					} else {
+						t = q.tasks.back();
+						q.tasks.pop_back();
+					}
+					return true;
+				}
+			}
+			return false;
+		}
+
+		// Advances cache t over the batches available, false once it is done
+		bool step(UINT32 t) {
+			SweepCache& c(caches[t]);
+			for (UINT32 k = 0; k < QUANTUM && bc.ready(c.seq); ++ k) {
+				size_t n;
+				const Access* a(bc.acquire(c.seq, n));
+				if (a == NULL) {
+					bc.release(c.seq ++);
+					return false;
+				}
+				c.cache->LookupAndFillBatch(a, n, NULL);
+				bc.release(c.seq ++);
+			}
+			return true;
+		}
+
+		void work(UINT32 w) {
+			while (left > 0) {
+				UINT32 t;
+				if (!pop(w, t)) {
+					std::this_thread::yield();
+					continue;
+				}
+				if (!bc.ready(caches[t].seq)) {
+					std::this_thread::yield();
+				}
+				if (step(t)) {
+					std::lock_guard<std::mutex> g(queues[w].lock);
+					queues[w].tasks.push_back(t);
+				} else {
+					-- left;
+				}
+			}
+		}
+};
+
+static bool readSweep(const char* path, const Options& o, std::vector<SweepCache>& caches) {
+	FILE* f(fopen(path, "r"));
+	if (f == NULL) {
+		perror(path);
+		return false;
+	}
+	char line[256];
+	for (int ln = 1; fgets(line, sizeof(line), f); ++ ln) {
+		char* p(line + strspn(line, " \t"));
+		if (*p == '#' || *p == '\n' || *p == 0) {
+			continue;
+		}
+		SweepCache c;
+		char policy[32];
+		const CRC_POLICY_OPS* ops(NULL);
+		if (sscanf(p, "%u:%u:%u:%31s", &c.size, &c.linesize, &c.assoc, policy) != 4
+				|| !c.size || !c.linesize || !c.assoc || (ops = CRC_FindPolicy(policy)) == NULL) {
+			fprintf(stderr, "%s:%d: expected size:linesize:assoc:policy\n", path, ln);
+			fclose(f);
+			return false;
+		}
+		c.policy = ops->id;
+		if (c.policy == CRC_REPL_OPT) {
+			fprintf(stderr, "%s:%d: OPT replacement needs a serial run\n", path, ln);
+			fclose(f);
+			return false;
+		}
+		c.cache = CRC_NewCache(c.size << 10, c.assoc, o.threads, c.linesize, c.policy, o.hugePages, true, 0, o.compact);
+		if (o.sample < 1) {
+			c.cache->SetSampling(o.sample);
+		}
+		c.cache->PrintMemory(cerr);
+		c.seq = 0;
+		caches.push_back(c);
+	}
+	fclose(f);
+	if (caches.empty()) {
+		fprintf(stderr, "%s: no configurations\n", path);
+		return false;
+	}
+	return true;
+}
+
+int runSweep(const Options& o, ostream& out) {
+	std::vector<SweepCache> caches;
+	if (!readSweep(o.sweep, o, caches)) {
+		return 1;
+	}
+	for (size_t i = 0; i < caches.size(); ++ i) {
+		if (caches[i].cache->Tags32()) {
+			if (!checkAddresses(o)) {
+				return 1;
+			}
+			break;
+		}
+	}
+	TraceReader* tr(openTrace(o.trace));
+	if (tr == NULL) {
+		return 1;
+	}
+	UINT32 workers(o.jobs ? o.jobs : std::max(1u, std::thread::hardware_concurrency()));
+	workers = std::min(workers, (UINT32)caches.size());
+
+	BatchBroadcast bc(caches.size());
+	SweepPool pool(caches, bc, workers);
+	COUNTER total(0);
+	std::chrono::steady_clock::time_point start(std::chrono::steady_clock::now());
+	for (size_t k; ; total += k) {
+		Access* b(bc.claim());
+		k = tr->read(b, BatchBroadcast::BATCH);
+		validate(b, k, o, tr, total);
+		bc.publish(k);
+		if (k == 0) {
+			break;
+		}
+	}
+	pool.join();
+	double secs(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+
+	out<<"size_kb,linesize,assoc,policy,lookups,misses,miss_rate,demand_lookups,demand_misses"<<endl;
+	for (size_t i = 0; i < caches.size(); ++ i) {
+		CRC_CACHE* c(caches[i].cache);
+		COUNTER dl(0), dm(0);
+		for (UINT32 t = 0; t < o.threads; ++ t) {
+			dl += c->ThreadDemandLookupStats(t);
+			dm += c->ThreadDemandMissStats(t);
+		}
+		out<<caches[i].size<<","<<caches[i].linesize<<","<<caches[i].assoc<<","<<CRC_FindPolicy(caches[i].policy)->name<<","
+			<<c->Scale(c->TotalLookupStats())<<","<<c->Scale(c->TotalMissStats())<<","
+			<<(double)c->TotalMissStats() / std::max(1ull, c->TotalLookupStats())<<","<<c->Scale(dl)<<","<<c->Scale(dm)<<endl;
+		delete c;
+	}
+	fprintf(stderr, "%zu configurations, %llu accesses in %.2fs, %.0f accesses/sec per configuration\n",
+			caches.size(), total, secs, secs > 0 ? total / secs : 0);
+	delete tr;
+	return 0;
+}
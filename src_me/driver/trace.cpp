@@ -0,0 +1,167 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "trace.h"
+#include "ctrace.h"
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Text trace parsing. The generic scanf family is far too slow for traces    //
+// of billions of lines, so fields are decoded by hand.                       //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+static inline const char* skipBlank(const char* p) {
+	while (*p == ' ' || *p == '\t' || *p == '\r') {
+		++ p;
+	}
+	return p;
+}
+
+static inline const char* parseDec(const char* p, UINT32& v) {
+	const char* s(p);
+	for (v = 0; *p >= '0' && *p <= '9'; ++ p) {
+		v = v * 10 + (*p - '0');
+	}
+	return p == s ? NULL : p;
+}
+
+static inline const char* parseHex(const char* p, Addr_t& v) {
+	if (p[0] == '0' && (p[1] == 'x' || p[1] == 'X')) {
+		p += 2;
+	}
+	const char* s(p);
+	for (v = 0; ; ++ p) {
+		if (*p >= '0' && *p <= '9') {
+			v = (v << 4) | (*p - '0');
+		} else if (*p >= 'a' && *p <= 'f') {
+			v = (v << 4) | (*p - 'a' + 10);
+		} else if (*p >= 'A' && *p <= 'F') {
+			v = (v << 4) | (*p - 'A' + 10);
+		} else {
+			break;
+		}
+	}
+	return p == s ? NULL : p;
+}
+
+GzTraceReader::GzTraceReader(const char* _path) {
+	path = _path;
+	f = gzopen(_path, "rb");
+	// Let zlib inflate big chunks as well
+	if (f) {
+		gzbuffer(f, BLOCK);
+	}
+	buf = new char[BLOCK + 1];
+	len = pos = 0;
+	eof = (f == NULL);
+	line = 0;
+}
+
+GzTraceReader::~GzTraceReader() {
+	if (f) {
+		gzclose(f);
+	}
+	delete [] buf;
+}
+
+// Keeps the unparsed tail and appends the next inflated block behind it
+bool GzTraceReader::fill() {
+	if (eof) {
+		return false;
+	}
+	len -= pos;
+	memmove(buf, buf + pos, len);
+	pos = 0;
+	int r(gzread(f, buf + len, BLOCK - len));
+	if (r <= 0) {
+		if (r < 0) {
+			int err;
+			fprintf(stderr, "%s: %s\n", name(), gzerror(f, &err));
+		}
+		eof = true;
+		// Terminate a last line that lacks its newline
+		if (len > 0 && buf[len - 1] != '\n') {
+			buf[len ++] = '\n';
+		}
+		return false;
+	}
+	len += r;
+	return true;
+}
+
+bool GzTraceReader::parse(Access& a) {
+	const char* p(skipBlank(buf + pos));
+	if ((p = parseDec(p, a.tid)) == NULL) {
+		return false;
+	}
+	if ((p = parseDec(skipBlank(p), a.type)) == NULL) {
+		return false;
+	}
+	if ((p = parseHex(skipBlank(p), a.pc)) == NULL) {
+		return false;
+	}
+	if ((p = parseHex(skipBlank(p), a.paddr)) == NULL) {
+		return false;
+	}
+	return *skipBlank(p) == '\n';
+}
+
+size_t GzTraceReader::read(Access* a, size_t n) {
+	size_t k(0);
+	while (k < n) {
+		char* nl((char*)memchr(buf + pos, '\n', len - pos));
+		if (nl == NULL) {
+			if (!fill() && pos == len) {
+				break;
+			}
+			continue;
+		}
+		++ line;
+		const char* p(skipBlank(buf + pos));
+		if (*p != '\n' && *p != '#') {
+			if (!parse(a[k])) {
+				*nl = 0;
+				fprintf(stderr, "%s:%llu: malformed record \"%s\"\n", name(), line, buf + pos);
+				exit(1);
+			}
+			++ k;
+		}
+		pos = nl + 1 - buf;
+	}
+	return k;
+}
+
+// Columnar traces are recognized by their magic, anything else goes to zlib
+TraceReader* openTrace(const char* path) {
+	char magic[8] = { 0 };
+	FILE* f(fopen(path, "rb"));
+	if (f) {
+		size_t r(fread(magic, 1, sizeof(magic), f));
+		fclose(f);
+		if (r == sizeof(magic) && (!memcmp(magic, CT_MAGIC, sizeof(magic)) || !memcmp(magic, CT_MAGIC_V2, sizeof(magic))
+				|| !memcmp(magic, CT_MAGIC_V1, sizeof(magic)))) {
+			CtTraceReader* r(new CtTraceReader(path));
+			if (!r->good()) {
+				delete r;
+				return NULL;
+			}
+			return r;
+		}
+		if (r == sizeof(magic) && !memcmp(magic, CZ_MAGIC, sizeof(magic))) {
+			CzTraceReader* r(new CzTraceReader(path));
+			if (!r->good()) {
+				delete r;
+				return NULL;
+			}
+			return r;
+		}
+	}
+	GzTraceReader* r(new GzTraceReader(path));
+	if (!r->good()) {
+		perror(path);
+		delete r;
+		return NULL;
+	}
+	return r;
+}
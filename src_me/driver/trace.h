@@ -0,0 +1,62 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Trace readers for the standalone LLC driver. A reader hands out LLC        //
+// references in blocks so that the simulation loop never touches I/O.        //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+#include <cstddef>
+#include <zlib.h>
+#include "utils.h"
+#include "access.h"
+
+class TraceReader {
+	public:
+		virtual ~TraceReader() {}
+		// Fills at most n accesses into buf, returns 0 at the end of the trace
+		virtual size_t read(Access* buf, size_t n) = 0;
+		// Number of accesses, 0 if it is unknown before reading the trace
+		virtual COUNTER count() const {
+			return 0;
+		}
+		// Moves to the given access, false if the trace is not seekable
+		virtual bool seek(COUNTER) {
+			return false;
+		}
+		// Name of the trace for error messages
+		const char* name() const {
+			return path.c_str();
+		}
+	protected:
+		string path;
+};
+
+// Streams a gzip'd text trace ("tid type pc paddr" per line, addresses in
+// hex) and parses it one inflated block at a time
+class GzTraceReader : public TraceReader {
+	public:
+		static const size_t BLOCK = 1 << 20;
+
+		GzTraceReader(const char*);
+		~GzTraceReader();
+		size_t read(Access*, size_t);
+		bool good() const {
+			return f != NULL;
+		}
+	private:
+		gzFile f;
+		char *buf;
+		size_t len, pos;
+		bool eof;
+		COUNTER line;
+		bool fill();
+		bool parse(Access&);
+};
+
+// Opens a trace by file name, returns NULL (after reporting) on failure
+TraceReader* openTrace(const char* path);
+
+#endif